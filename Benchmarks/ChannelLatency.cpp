@@ -0,0 +1,179 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	ChannelLatency.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Per-call latency driver for multithread OutputChannels. N producer threads share one connector, as in the
+///				 SameChannelIDsDifferentParams test, and time every channel << message << endl into a LatencyHistogram.
+///				 p50/p99/p99.9/max are printed for each combination of stream count, stamp type, message size and target.
+///
+///				 Usage: channellatency [producer threads (default: core count, minimum 2)] [milliseconds per configuration (default: 200)]
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "OutputStreams/StreamAndChannelAliases.h"
+#include "LatencyHistogram.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mbp;
+using namespace mbp::streams;
+using namespace std::chrono;
+
+namespace
+{
+	// an OutputTarget that discards everything, isolating the channel and stream locking costs
+	template< typename ELEM_ >
+	class OutputDiscard_t
+	{
+	public:
+		OutputDiscard_t( char const * const initString_ = nullptr )
+		{}
+		void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+		{}
+	};
+
+	struct StampType
+	{
+		char const * name;
+		OutputStamp & ( *getStamp )();
+	};
+
+	OutputStamp & GetNoStamp() { return OutputStamp::GetDummyStamp(); }
+	OutputStamp & GetSystemTimeStamp() { return SystemTimeStamp_t< char >::GetInstance(); }
+	OutputStamp & GetLineStamp() { return LineStamp_t< char >::GetInstance(); }
+
+	StampType const kStampTypes[] = {
+			{ "none", GetNoStamp }
+		,	{ "SystemTime", GetSystemTimeStamp }
+		,	{ "Line", GetLineStamp }
+	};
+	size_t const kStreamCounts[] = { 1, 2, 4 };
+	size_t const kMessageSizes[] = { 16, 128, 1024 };
+
+	struct Configuration
+	{
+		size_t numThreads;
+		size_t numStreams;
+		StampType const * stamp;
+		size_t messageSize;
+		char const * targetName;
+		milliseconds duration;
+	};
+
+	void ProducerThread( StreamList< char > const & connector_, OutputStamp & stamp_, std::string const & message_, std::atomic< bool > const & start_, std::atomic< bool > const & stop_, bench::LatencyHistogram & histogram_ )
+	{
+		OutputChannel< char > channel( 0, connector_, true, stamp_ );
+		while ( !start_.load( std::memory_order_acquire ) )
+			std::this_thread::yield();
+		while ( !stop_.load( std::memory_order_relaxed ) )
+		{
+			auto before = steady_clock::now();
+			channel << message_.c_str() << endl;
+			auto after = steady_clock::now();
+			histogram_.Record( static_cast< uint64_t >( duration_cast< nanoseconds >( after - before ).count() ) );
+		}
+	}
+
+	template< template< typename > typename TARGET_ >
+	bench::LatencyHistogram RunConfiguration( Configuration const & config_ )
+	{
+		std::vector< std::string > filenames;
+		std::vector< std::unique_ptr< OutputStream< char, TARGET_ > > > streams;
+		StreamList< char > connector;
+		for ( size_t i = 0; i < config_.numStreams; ++i )
+		{
+			filenames.push_back( "channellatency_" + std::to_string( i ) + ".test.txt" );
+			streams.emplace_back( new OutputStream< char, TARGET_ >( filenames.back().c_str() ) );
+			connector.push_back( streams.back().get() );
+		}
+
+		std::string message( config_.messageSize, 'x' );
+		std::atomic< bool > start( false ), stop( false );
+		std::vector< bench::LatencyHistogram > histograms( config_.numThreads );
+		std::vector< std::thread > producers;
+		for ( size_t i = 0; i < config_.numThreads; ++i )
+			producers.emplace_back( ProducerThread, std::cref( connector ), std::ref( config_.stamp->getStamp() ), std::cref( message ), std::cref( start ), std::cref( stop ), std::ref( histograms[ i ] ) );
+
+		start.store( true, std::memory_order_release );
+		std::this_thread::sleep_for( config_.duration );
+		stop.store( true, std::memory_order_relaxed );
+		for ( auto & i : producers )
+			i.join();
+
+		bench::LatencyHistogram merged;
+		for ( auto & i : histograms )
+			merged.Merge( i );
+		streams.clear();
+		for ( auto & i : filenames )
+			std::remove( i.c_str() );
+		return merged;
+	}
+
+	void PrintHeader()
+	{
+		std::printf( "%-8s %-8s %-11s %-9s %-10s %12s %10s %10s %10s %12s\n", "threads", "streams", "stamp", "msgsize", "target", "calls", "p50(ns)", "p99(ns)", "p99.9(ns)", "max(ns)" );
+	}
+
+	void PrintResult( Configuration const & config_, bench::LatencyHistogram const & histogram_ )
+	{
+		std::printf( "%-8zu %-8zu %-11s %-9zu %-10s %12llu %10llu %10llu %10llu %12llu\n"
+			, config_.numThreads, config_.numStreams, config_.stamp->name, config_.messageSize, config_.targetName
+			, static_cast< unsigned long long >( histogram_.GetCount() )
+			, static_cast< unsigned long long >( histogram_.GetValueAtPercentile( 50.0 ) )
+			, static_cast< unsigned long long >( histogram_.GetValueAtPercentile( 99.0 ) )
+			, static_cast< unsigned long long >( histogram_.GetValueAtPercentile( 99.9 ) )
+			, static_cast< unsigned long long >( histogram_.GetMax() ) );
+		std::fflush( stdout );
+	}
+}
+
+int main( int argc, char ** argv )
+{
+	size_t numThreads = std::thread::hardware_concurrency();
+	if ( argc > 1 )
+		numThreads = std::strtoul( argv[ 1 ], nullptr, 10 );
+	// contention needs at least two producers
+	if ( numThreads < 2 )
+		numThreads = 2;
+	milliseconds duration( argc > 2 ? std::strtoul( argv[ 2 ], nullptr, 10 ) : 200 );
+
+	// std::cout is pointed at the null device while the stdout target runs, the results are printed with printf
+	std::filebuf nullDevice;
+#if defined( _MSC_VER )
+	nullDevice.open( "NUL", std::ios_base::out );
+#else
+	nullDevice.open( "/dev/null", std::ios_base::out );
+#endif // #if defined( _MSC_VER )
+
+	PrintHeader();
+	for ( auto numStreams : kStreamCounts )
+	{
+		for ( auto & stamp : kStampTypes )
+		{
+			for ( auto messageSize : kMessageSizes )
+			{
+				Configuration config{ numThreads, numStreams, &stamp, messageSize, "discard", duration };
+				PrintResult( config, RunConfiguration< OutputDiscard_t >( config ) );
+
+				config.targetName = "file";
+				PrintResult( config, RunConfiguration< OutputFile_t >( config ) );
+
+				config.targetName = "stdout";
+				std::streambuf * savedStdOut = std::cout.rdbuf( &nullDevice );
+				bench::LatencyHistogram histogram = RunConfiguration< OutputStdOut_t >( config );
+				std::cout.rdbuf( savedStdOut );
+				PrintResult( config, histogram );
+			}
+		}
+	}
+	return 0;
+}
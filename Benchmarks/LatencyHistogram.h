@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	LatencyHistogram.h
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: An HDR style latency histogram. Values below kSubBucketCount are counted exactly, larger values fall into
+///				 log-linear buckets: each power of two is split into kSubBucketCount / 2 equal sub-buckets, which bounds the
+///				 relative error of any reported percentile to 1 / ( kSubBucketCount / 2 ) across the whole 64 bit range.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef LatencyHistogram_DEFINED_19_10_2026
+#define LatencyHistogram_DEFINED_19_10_2026
+
+#include <cstdint>
+#include <vector>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif // #if defined( _MSC_VER )
+
+namespace mbp
+{
+	namespace bench
+	{
+		class LatencyHistogram
+		{
+		public:
+			static constexpr int kSubBucketBits = 6;
+			static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+			static constexpr int kHalfSubBucketCount = kSubBucketCount >> 1;
+			static constexpr int kNumBuckets = kSubBucketCount + ( 64 - kSubBucketBits ) * kHalfSubBucketCount;
+
+			LatencyHistogram()
+				: m_counts( kNumBuckets, 0 )
+				, m_total( 0 )
+				, m_max( 0 )
+			{}
+
+			void Record( uint64_t value_ )
+			{
+				++m_counts[ IndexOf( value_ ) ];
+				++m_total;
+				if ( value_ > m_max )
+					m_max = value_;
+			}
+
+			void Merge( LatencyHistogram const & other_ )
+			{
+				for ( size_t i = 0; i < m_counts.size(); ++i )
+					m_counts[ i ] += other_.m_counts[ i ];
+				m_total += other_.m_total;
+				if ( other_.m_max > m_max )
+					m_max = other_.m_max;
+			}
+
+			void Reset()
+			{
+				m_counts.assign( kNumBuckets, 0 );
+				m_total = m_max = 0;
+			}
+
+			// returns the highest value equivalent to the bucket containing the given percentile (0 ... 100)
+			uint64_t GetValueAtPercentile( double percentile_ ) const
+			{
+				if ( 0 == m_total )
+					return 0;
+				uint64_t target = static_cast< uint64_t >( percentile_ / 100.0 * static_cast< double >( m_total ) + 0.5 );
+				if ( target == 0 )
+					target = 1;
+				uint64_t running = 0;
+				for ( size_t i = 0; i < m_counts.size(); ++i )
+				{
+					running += m_counts[ i ];
+					if ( running >= target )
+					{
+						uint64_t value = HighestValueOf( i );
+						return value < m_max ? value : m_max;
+					}
+				}
+				return m_max;
+			}
+
+			uint64_t GetMax() const { return m_max; }
+			uint64_t GetCount() const { return m_total; }
+
+		private:
+			static int MostSignificantBit( uint64_t value_ )
+			{
+#if defined( _MSC_VER )
+				unsigned long index;
+				_BitScanReverse64( &index, value_ );
+				return static_cast< int >( index );
+#else
+				return 63 - __builtin_clzll( value_ );
+#endif // #if defined( _MSC_VER )
+			}
+
+			static size_t IndexOf( uint64_t value_ )
+			{
+				if ( value_ < kSubBucketCount )
+					return static_cast< size_t >( value_ );
+				// magnitude 1 holds kSubBucketCount ... 2 * kSubBucketCount - 1 in steps of 2 and so on
+				int magnitude = MostSignificantBit( value_ ) - kSubBucketBits + 1;
+				size_t subBucket = static_cast< size_t >( value_ >> magnitude ) - kHalfSubBucketCount;
+				return kSubBucketCount + ( magnitude - 1 ) * kHalfSubBucketCount + subBucket;
+			}
+
+			static uint64_t HighestValueOf( size_t index_ )
+			{
+				if ( index_ < kSubBucketCount )
+					return index_;
+				size_t offset = index_ - kSubBucketCount;
+				int magnitude = static_cast< int >( offset / kHalfSubBucketCount ) + 1;
+				uint64_t subBucket = offset % kHalfSubBucketCount + kHalfSubBucketCount;
+				return ( ( subBucket + 1 ) << magnitude ) - 1;
+			}
+
+			std::vector< uint64_t > m_counts;
+			uint64_t m_total;
+			uint64_t m_max;
+		};
+	}
+}
+
+#endif // #ifndef LatencyHistogram_DEFINED_19_10_2026
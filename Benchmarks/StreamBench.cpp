@@ -0,0 +1,455 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	StreamBench.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Google Benchmark microbenchmarks for the OutputStreams hot paths
+///				 Every benchmark reports lines/s and time per line. Threaded benchmarks sweep from one thread to the core count.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "benchmark/benchmark.h"
+#include "OutputStreams/StreamAndChannelAliases.h"
+#include "StreamTestStrings.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace mbp;
+using namespace mbp::streams;
+
+namespace
+{
+	auto constexpr kBenchFilename = "streambench.test.txt";
+	auto constexpr kLinesBetweenMemResets = 1024;
+	int const kMaxThreads = static_cast< int >( std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1 );
+
+	// an OutputTarget that discards everything, so insertion benchmarks measure the library rather than the sink
+	template< typename ELEM_ >
+	class OutputDiscard_t
+	{
+	public:
+		OutputDiscard_t( char const * const initString_ = nullptr )
+		{}
+		void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+		{
+			benchmark::DoNotOptimize( output_ );
+		}
+	};
+
+	// lines/s and time per line for the given number of lines per iteration, summed over all threads
+	// time/line is held in seconds, which the console reporter scales for display (e.g. 250.3ns)
+	void SetLineCounters( benchmark::State & state_, size_t linesPerIteration_ = 1 )
+	{
+		double lines = static_cast< double >( state_.iterations() * linesPerIteration_ );
+		state_.SetItemsProcessed( static_cast< int64_t >( lines ) );
+		state_.counters[ "lines/s" ] = benchmark::Counter( lines, benchmark::Counter::kIsRate );
+		state_.counters[ "time/line" ] = benchmark::Counter( lines, benchmark::Counter::kIsRate | benchmark::Counter::kInvert );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Sample text in each source encoding, converted once from the UTF8 test strings
+	//////////////////////////////////////////////////////////////////////////
+
+	template< typename ELEM_ >
+	std::vector< std::basic_string< ELEM_ > > const & GetSampleText();
+
+	template<>
+	std::vector< std::string > const & GetSampleText< char >()
+	{
+		static std::vector< std::string > text( std::begin( AllUTF8Strings ), std::end( AllUTF8Strings ) );
+		return text;
+	}
+
+	template<>
+	std::vector< std::u32string > const & GetSampleText< char32_t >()
+	{
+		static std::vector< std::u32string > text = []()
+		{
+			std::vector< std::u32string > result;
+			for ( auto * i : AllUTF8Strings )
+			{
+				std::u32string converted( strings::GetUTF8StringLengthInBytes( i ) + 1, 0 );
+				strings::UTF8ToUTF32( i, &converted[ 0 ] );
+				converted.resize( strings::GetUTF32StringLengthInCharacters( converted.c_str() ) );
+				result.push_back( converted );
+			}
+			return result;
+		}();
+		return text;
+	}
+
+	template<>
+	std::vector< std::u16string > const & GetSampleText< char16_t >()
+	{
+		static std::vector< std::u16string > text = []()
+		{
+			std::vector< std::u16string > result;
+			for ( auto * i : AllUTF8Strings )
+			{
+				std::u16string converted( strings::GetUTF8StringLengthInBytes( i ) + 1, 0 );
+				strings::UTF8ToUTF16( i, &converted[ 0 ] );
+				converted.resize( strings::GetUTF16StringLengthInBytes( converted.c_str() ) / sizeof( char16_t ) );
+				result.push_back( converted );
+			}
+			return result;
+		}();
+		return text;
+	}
+
+	template<>
+	std::vector< std::wstring > const & GetSampleText< wchar_t >()
+	{
+		static std::vector< std::wstring > text = []()
+		{
+			std::vector< std::wstring > result;
+#if defined( _MSC_VER )
+			for ( auto & i : GetSampleText< char16_t >() )
+				result.emplace_back( reinterpret_cast< wchar_t const * >( i.c_str() ), i.length() );
+#else
+			for ( auto & i : GetSampleText< char32_t >() )
+				result.emplace_back( reinterpret_cast< wchar_t const * >( i.c_str() ), i.length() );
+#endif // #if defined( _MSC_VER )
+			return result;
+		}();
+		return text;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	/// OutputStream_t and OutputChannel_t insertion
+	//////////////////////////////////////////////////////////////////////////
+
+	// each thread owns its stream, so this scales with no shared state
+	void BM_StreamInsert( benchmark::State & state_ )
+	{
+		OutputStream< char, OutputDiscard_t > stream;
+		int64_t i = 0;
+		for ( auto _ : state_ )
+			stream << "OutputStream line " << ++i << ", " << 3.25 << endl;
+		SetLineCounters( state_ );
+	}
+	BENCHMARK( BM_StreamInsert )->DenseThreadRange( 1, kMaxThreads )->UseRealTime();
+
+	void BM_ChannelInsert_SingleThreadMode( benchmark::State & state_ )
+	{
+		OutputStream< char, OutputDiscard_t > stream;
+		StreamList< char > connector{ &stream };
+		OutputChannel< char > channel( 0, connector, false );
+		int64_t i = 0;
+		for ( auto _ : state_ )
+			channel << "OutputChannel line " << ++i << ", " << 3.25 << endl;
+		SetLineCounters( state_ );
+	}
+	BENCHMARK( BM_ChannelInsert_SingleThreadMode );
+
+	// every thread has its own multithread channel, all sharing one target stream
+	OutputStream< char, OutputDiscard_t > * g_sharedStream = nullptr;
+	StreamList< char > * g_sharedConnector = nullptr;
+	ChannelConnector< char > * g_sharedChannelConnector = nullptr;
+
+	void SetupSharedStream( benchmark::State const & state_ )
+	{
+		g_sharedStream = new OutputStream< char, OutputDiscard_t >();
+		g_sharedConnector = new StreamList< char >{ g_sharedStream };
+		g_sharedChannelConnector = new ChannelConnector< char >( *g_sharedConnector );
+	}
+
+	void TeardownSharedStream( benchmark::State const & state_ )
+	{
+		delete g_sharedChannelConnector;
+		delete g_sharedConnector;
+		delete g_sharedStream;
+		g_sharedChannelConnector = nullptr;
+		g_sharedConnector = nullptr;
+		g_sharedStream = nullptr;
+	}
+
+	// the same shared stream with flat combining instead of each channel retrying the stream's lock
+	void SetupSharedCombiningStream( benchmark::State const & state_ )
+	{
+		SetupSharedStream( state_ );
+		g_sharedStream->SetCombining( true );
+	}
+
+	void BM_ChannelInsert_MultiThreadMode( benchmark::State & state_ )
+	{
+		int64_t i = 0;
+		{
+			OutputChannel< char > channel( 0, *g_sharedConnector, true );
+			for ( auto _ : state_ )
+				channel << "OutputChannel line " << ++i << ", " << 3.25 << endl;
+		}
+		SetLineCounters( state_ );
+	}
+	BENCHMARK( BM_ChannelInsert_MultiThreadMode )->Setup( SetupSharedStream )->Teardown( TeardownSharedStream )->DenseThreadRange( 1, kMaxThreads )->UseRealTime();
+
+	void BM_ChannelInsert_Combining( benchmark::State & state_ )
+	{
+		BM_ChannelInsert_MultiThreadMode( state_ );
+	}
+	BENCHMARK( BM_ChannelInsert_Combining )->Setup( SetupSharedCombiningStream )->Teardown( TeardownSharedStream )->DenseThreadRange( 1, kMaxThreads )->UseRealTime();
+
+	template< typename CONNECTOR_ >
+	CONNECTOR_ const & GetSharedConnector();
+	template<>
+	StreamList< char > const & GetSharedConnector() { return *g_sharedConnector; }
+	template<>
+	ChannelConnector< char > const & GetSharedConnector() { return *g_sharedChannelConnector; }
+
+	// a short-lived task's channel: construct, write one line, destroy. CONNECTOR_ is a StreamList or a pre-resolved ChannelConnector.
+	template< typename CONNECTOR_ >
+	void BM_ChannelLifetime( benchmark::State & state_ )
+	{
+		int64_t i = 0;
+		for ( auto _ : state_ )
+		{
+			OutputChannel< char > channel( 0, GetSharedConnector< CONNECTOR_ >(), true );
+			channel << "OutputChannel line " << ++i << endl;
+		}
+		SetLineCounters( state_ );
+	}
+	BENCHMARK_TEMPLATE( BM_ChannelLifetime, StreamList< char > )->Setup( SetupSharedStream )->Teardown( TeardownSharedStream )->DenseThreadRange( 1, kMaxThreads )->UseRealTime();
+	BENCHMARK_TEMPLATE( BM_ChannelLifetime, ChannelConnector< char > )->Setup( SetupSharedStream )->Teardown( TeardownSharedStream )->DenseThreadRange( 1, kMaxThreads )->UseRealTime();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// OutputStamps
+	//////////////////////////////////////////////////////////////////////////
+
+	void BM_Stamp( benchmark::State & state_, OutputStamp & stamp_, size_t elementSize_ )
+	{
+		char32_t buffer[ 256 ];
+		for ( auto _ : state_ )
+		{
+			stamp_.Lock();
+			auto length = stamp_.GetLength();
+			stamp_.WriteStamp( reinterpret_cast< char * >( buffer ) + ( stamp_.GetMaxLength() - length ) * elementSize_ );
+			stamp_.Unlock();
+			benchmark::DoNotOptimize( buffer );
+		}
+		SetLineCounters( state_ );
+	}
+	BENCHMARK_CAPTURE( BM_Stamp, DummyStamp, OutputStamp::GetDummyStamp(), sizeof( char ) );
+	BENCHMARK_CAPTURE( BM_Stamp, SystemTimeStamp_char, SystemTimeStamp_t< char >::GetInstance(), sizeof( char ) );
+	BENCHMARK_CAPTURE( BM_Stamp, SystemTimeStamp_wchar_t, SystemTimeStamp_t< wchar_t >::GetInstance(), sizeof( wchar_t ) );
+	BENCHMARK_CAPTURE( BM_Stamp, SystemTimeStamp_char16_t, SystemTimeStamp_t< char16_t >::GetInstance(), sizeof( char16_t ) );
+	BENCHMARK_CAPTURE( BM_Stamp, SystemTimeStamp_char32_t, SystemTimeStamp_t< char32_t >::GetInstance(), sizeof( char32_t ) );
+	BENCHMARK_CAPTURE( BM_Stamp, LineStamp_char, LineStamp_t< char >::GetInstance(), sizeof( char ) );
+
+	//////////////////////////////////////////////////////////////////////////
+	/// ConvertText pairs and TextCatcher over the sample scripts
+	//////////////////////////////////////////////////////////////////////////
+
+	template< typename DEST_, typename SRC_ >
+	void BM_ConvertText( benchmark::State & state_ )
+	{
+		OutputStream< DEST_, OutputDiscard_t, ConvertingStream_t > stream;
+		auto const & text = GetSampleText< SRC_ >();
+		int64_t bytes = 0;
+		for ( auto & i : text )
+			bytes += i.length() * sizeof( SRC_ );
+		for ( auto _ : state_ )
+		{
+			for ( auto & i : text )
+			{
+				stream << i.c_str();
+				stream.flush();
+			}
+		}
+		state_.SetBytesProcessed( state_.iterations() * bytes );
+		SetLineCounters( state_, text.size() );
+	}
+	BENCHMARK_TEMPLATE( BM_ConvertText, char, char32_t );
+	BENCHMARK_TEMPLATE( BM_ConvertText, char16_t, char32_t );
+	BENCHMARK_TEMPLATE( BM_ConvertText, char, char16_t );
+	BENCHMARK_TEMPLATE( BM_ConvertText, char32_t, char16_t );
+	BENCHMARK_TEMPLATE( BM_ConvertText, char32_t, char );
+	BENCHMARK_TEMPLATE( BM_ConvertText, char16_t, char );
+	BENCHMARK_TEMPLATE( BM_ConvertText, wchar_t, char );
+	BENCHMARK_TEMPLATE( BM_ConvertText, char, wchar_t );
+#if defined( __linux )
+	BENCHMARK_TEMPLATE( BM_ConvertText, wchar_t, char16_t );
+	BENCHMARK_TEMPLATE( BM_ConvertText, char16_t, wchar_t );
+#elif defined( _MSC_VER )
+	BENCHMARK_TEMPLATE( BM_ConvertText, wchar_t, char32_t );
+	BENCHMARK_TEMPLATE( BM_ConvertText, char32_t, wchar_t );
+#endif // #if defined( __linux )
+
+	template< typename DEST_, typename SRC_ >
+	void BM_TextCatcher( benchmark::State & state_ )
+	{
+		OutputStream< DEST_, OutputDiscard_t > stream;
+		auto const & text = GetSampleText< SRC_ >();
+		for ( auto _ : state_ )
+		{
+			for ( auto & i : text )
+			{
+				stream << i.c_str();
+				stream.flush();
+			}
+		}
+		SetLineCounters( state_, text.size() );
+	}
+	BENCHMARK_TEMPLATE( BM_TextCatcher, char32_t, char );
+	BENCHMARK_TEMPLATE( BM_TextCatcher, char16_t, char );
+	BENCHMARK_TEMPLATE( BM_TextCatcher, wchar_t, char );
+	BENCHMARK_TEMPLATE( BM_TextCatcher, char, char32_t );
+
+	//////////////////////////////////////////////////////////////////////////
+	/// OutputTargets, each fed the same line directly
+	//////////////////////////////////////////////////////////////////////////
+
+	template< typename ELEM_ >
+	std::basic_string< ELEM_ > MakeTargetLine()
+	{
+		std::string narrow = "A typical diagnostic line written straight to the OutputTarget\n";
+		return std::basic_string< ELEM_ >( narrow.begin(), narrow.end() );
+	}
+
+	void BM_Target_OutputMem( benchmark::State & state_ )
+	{
+		OutputMem_t< char > target( nullptr );
+		auto line = MakeTargetLine< char >();
+		int count = 0;
+		for ( auto _ : state_ )
+		{
+			target.Output( line.c_str(), static_cast< uint32_t >( line.length() ), static_cast< uint32_t >( line.length() ) );
+			if ( ++count == kLinesBetweenMemResets )
+			{
+				target.Reset();
+				count = 0;
+			}
+		}
+		SetLineCounters( state_ );
+	}
+	BENCHMARK( BM_Target_OutputMem );
+
+	void BM_Target_FlightRecorder( benchmark::State & state_ )
+	{
+		OutputFlightRecorder_t< char > target;
+		auto line = MakeTargetLine< char >();
+		for ( auto _ : state_ )
+			target.Output( line.c_str(), static_cast< uint32_t >( line.length() ), static_cast< uint32_t >( line.length() ) );
+		SetLineCounters( state_ );
+	}
+	BENCHMARK( BM_Target_FlightRecorder );
+
+	// every thread records to the same ring, which needs no lock
+	FlightRecorder g_flightRecorder;
+	void BM_FlightRecorder_SharedRecord( benchmark::State & state_ )
+	{
+		auto line = MakeTargetLine< char >();
+		for ( auto _ : state_ )
+			g_flightRecorder.Record( line.c_str(), line.length() );
+		SetLineCounters( state_ );
+	}
+	BENCHMARK( BM_FlightRecorder_SharedRecord )->DenseThreadRange( 1, kMaxThreads )->UseRealTime();
+
+	template< typename TARGET_, typename ELEM_ >
+	void BM_Target_File( benchmark::State & state_ )
+	{
+		{
+			TARGET_ target( kBenchFilename );
+			auto line = MakeTargetLine< ELEM_ >();
+			for ( auto _ : state_ )
+				target.Output( line.c_str(), static_cast< uint32_t >( line.length() ), static_cast< uint32_t >( line.length() * sizeof( ELEM_ ) ) );
+		}
+		std::remove( kBenchFilename );
+		SetLineCounters( state_ );
+	}
+	BENCHMARK_TEMPLATE( BM_Target_File, OutputFile_t< char >, char );
+	BENCHMARK_TEMPLATE( BM_Target_File, OutputFile_t< char32_t >, char32_t );
+	BENCHMARK_TEMPLATE( BM_Target_File, OutputFileUTF8_t< char32_t >, char32_t );
+#if defined( __linux )
+	BENCHMARK_TEMPLATE( BM_Target_File, OutputMmapFile_t< char >, char );
+	BENCHMARK_TEMPLATE( BM_Target_File, OutputUringFile_t< char >, char )->UseRealTime();
+#endif // #if defined( __linux )
+
+	// asynchronous targets are flushed so their queued output is included in the time
+	template< typename TARGET_, typename = void >
+	struct HasFlush : std::false_type {};
+	template< typename TARGET_ >
+	struct HasFlush< TARGET_, std::void_t< decltype( std::declval< TARGET_ & >().Flush() ) > > : std::true_type {};
+
+	// sustained throughput: each iteration writes kBlocksPerFlush blocks of the given size then flushes, reported as bytes/s of wall clock time
+	// since io_uring writes complete on kernel workers rather than the calling thread
+	auto constexpr kBlocksPerFlush = 64;
+	template< typename TARGET_ >
+	void BM_Target_FileThroughput( benchmark::State & state_ )
+	{
+		{
+			TARGET_ target( kBenchFilename );
+			std::string block( static_cast< size_t >( state_.range( 0 ) ), 'x' );
+			block.back() = '\n';
+			for ( auto _ : state_ )
+			{
+				for ( int i = 0; i < kBlocksPerFlush; ++i )
+					target.Output( block.data(), static_cast< uint32_t >( block.size() ), static_cast< uint32_t >( block.size() ) );
+				if constexpr ( HasFlush< TARGET_ >::value )
+					target.Flush();
+			}
+		}
+		std::remove( kBenchFilename );
+		state_.SetBytesProcessed( state_.iterations() * kBlocksPerFlush * state_.range( 0 ) );
+		SetLineCounters( state_, kBlocksPerFlush );
+	}
+	BENCHMARK_TEMPLATE( BM_Target_FileThroughput, OutputFile_t< char > )->Arg( 128 )->Arg( 4096 )->Arg( 65536 )->UseRealTime();
+#if defined( __linux )
+	BENCHMARK_TEMPLATE( BM_Target_FileThroughput, OutputMmapFile_t< char > )->Arg( 128 )->Arg( 4096 )->Arg( 65536 )->UseRealTime();
+	BENCHMARK_TEMPLATE( BM_Target_FileThroughput, OutputUringFile_t< char > )->Arg( 128 )->Arg( 4096 )->Arg( 65536 )->UseRealTime();
+	BENCHMARK_TEMPLATE( BM_Target_FileThroughput, OutputDirectFile_t< char > )->Arg( 128 )->Arg( 4096 )->Arg( 65536 )->UseRealTime();
+#endif // #if defined( __linux )
+
+	// std::cout is pointed at the null device for the duration, so the benchmark reporter is unaffected
+	std::filebuf g_nullDevice;
+	std::streambuf * g_savedStdOut = nullptr;
+
+	void SetupStdOutToNull( benchmark::State const & state_ )
+	{
+#if defined( _MSC_VER )
+		g_nullDevice.open( "NUL", std::ios_base::out );
+#else
+		g_nullDevice.open( "/dev/null", std::ios_base::out );
+#endif // #if defined( _MSC_VER )
+		g_savedStdOut = std::cout.rdbuf( &g_nullDevice );
+	}
+
+	void TeardownStdOutToNull( benchmark::State const & state_ )
+	{
+		std::cout.rdbuf( g_savedStdOut );
+		g_nullDevice.close();
+	}
+
+	void BM_Target_OutputStdOut( benchmark::State & state_ )
+	{
+		OutputStdOut_t< char > target;
+		auto line = MakeTargetLine< char >();
+		for ( auto _ : state_ )
+			target.Output( line.c_str(), static_cast< uint32_t >( line.length() ), static_cast< uint32_t >( line.length() ) );
+		SetLineCounters( state_ );
+	}
+	BENCHMARK( BM_Target_OutputStdOut )->Setup( SetupStdOutToNull )->Teardown( TeardownStdOutToNull );
+
+#if defined( __linux )
+	// the descriptor target is given the null device's descriptor, so is buffered as it would be under a supervisor's pipe
+	void BM_Target_OutputStdFd( benchmark::State & state_ )
+	{
+		int desc = open( "/dev/null", O_WRONLY );
+		{
+			OutputStdFd_t< char > target( std::to_string( desc ).c_str() );
+			auto line = MakeTargetLine< char >();
+			for ( auto _ : state_ )
+				target.Output( line.c_str(), static_cast< uint32_t >( line.length() ), static_cast< uint32_t >( line.length() ) );
+		}
+		close( desc );
+		SetLineCounters( state_ );
+	}
+	BENCHMARK( BM_Target_OutputStdFd );
+#endif // #if defined( __linux )
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	BacktraceRing.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Keeps the most recent of the lines a channel holds back, the backtrace stage of ChannelBuffer_t
+///
+///				 A ring of complete lines, overwriting the oldest once full. Draining it hands the kept lines over oldest first and
+///				 empties it. Each line's string keeps its storage when overwritten, so a steady state allocates nothing. Each ring has
+///				 a single writer.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef BacktraceRing_DEFINED_19_10_2026
+#define BacktraceRing_DEFINED_19_10_2026
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace mbp
+{
+	namespace streams
+	{
+		template< typename ELEM_ >
+		class BacktraceRing_t
+		{
+		public:
+			// discards the kept lines, returning how many there were. A zero size disables the ring.
+			size_t Resize( size_t numLines_ )
+			{
+				size_t discarded = Discard();
+				m_lines.resize( numLines_ );
+				m_next = 0;
+				return discarded;
+			}
+			bool IsEnabled() const { return !m_lines.empty(); }
+			size_t GetCount() const { return m_count; }
+
+			// keeps a line in an enabled ring, returning true if the oldest line was dropped to make room
+			bool Keep( ELEM_ const * line_, size_t length_ )
+			{
+				bool const full = m_count == m_lines.size();
+				if ( !full )
+					++m_count;
+				m_lines[ m_next ].assign( line_, length_ );
+				m_next = ( m_next + 1 ) % m_lines.size();
+				return full;
+			}
+			// calls emit_( ELEM_ const * line, size_t length ) for each kept line, oldest first, and empties the ring
+			template< typename EMIT_ >
+			void Drain( EMIT_ && emit_ )
+			{
+				if ( 0 == m_count )
+					return;
+				size_t const oldest = ( m_next + m_lines.size() - m_count ) % m_lines.size();
+				for ( size_t i = 0; i < m_count; ++i )
+				{
+					auto const & kept = m_lines[ ( oldest + i ) % m_lines.size() ];
+					emit_( kept.data(), kept.size() );
+				}
+				m_count = 0;
+			}
+			// empties the ring, returning the number of lines discarded
+			size_t Discard()
+			{
+				size_t discarded = m_count;
+				m_count = 0;
+				return discarded;
+			}
+
+		private:
+			std::vector< std::basic_string< ELEM_ > > m_lines;
+			size_t m_next = 0;		// the slot the next kept line goes in
+			size_t m_count = 0;
+		};
+	}
+}
+
+#endif // #ifndef BacktraceRing_DEFINED_19_10_2026
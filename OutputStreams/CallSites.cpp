@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	CallSites.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Call site registration, listing and pattern matching
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "CallSites.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+namespace mbp
+{
+	namespace streams
+	{
+		namespace
+		{
+			// sites register during static initialisation, so the list head is constant initialized and the mutex is constructed on first use
+			CallSite * g_callSites = nullptr;
+
+			std::mutex & GetCallSiteMutex()
+			{
+				static std::mutex mutex;
+				return mutex;
+			}
+
+			bool GlobMatch( char const * pattern_, char const * text_ )
+			{
+				char const * star = nullptr;
+				char const * resume = nullptr;
+				while ( *text_ )
+				{
+					if ( *pattern_ == '*' )
+					{
+						star = pattern_++;
+						resume = text_;
+					}
+					else if ( *pattern_ == '?' || *pattern_ == *text_ )
+					{
+						++pattern_;
+						++text_;
+					}
+					else if ( star )
+					{
+						pattern_ = star + 1;
+						text_ = ++resume;
+					}
+					else
+						return false;
+				}
+				while ( *pattern_ == '*' )
+					++pattern_;
+				return !*pattern_;
+			}
+
+			char const * GetBaseName( char const * file_ )
+			{
+				char const * base = file_;
+				for ( char const * i = file_; *i; ++i )
+					if ( *i == '/' || *i == '\\' )
+						base = i + 1;
+				return base;
+			}
+		}
+
+		void RegisterCallSite( CallSite * site_ )
+		{
+			std::lock_guard< std::mutex > lock( GetCallSiteMutex() );
+			site_->next = g_callSites;
+			g_callSites = site_;
+		}
+
+		// sites are destroyed in the reverse of the order they registered, so each is normally at the head of the list
+		void UnregisterCallSite( CallSite * site_ )
+		{
+			std::lock_guard< std::mutex > lock( GetCallSiteMutex() );
+			for ( CallSite ** i = &g_callSites; *i; i = &( *i )->next )
+			{
+				if ( *i == site_ )
+				{
+					*i = site_->next;
+					site_->next = nullptr;
+					return;
+				}
+			}
+		}
+
+		std::vector< CallSite * > GetCallSites()
+		{
+			std::vector< CallSite * > sites;
+			{
+				std::lock_guard< std::mutex > lock( GetCallSiteMutex() );
+				for ( CallSite * i = g_callSites; i; i = i->next )
+					sites.push_back( i );
+			}
+			std::sort( sites.begin(), sites.end(), []( CallSite const * a_, CallSite const * b_ )
+			{
+				int order = std::strcmp( a_->file, b_->file );
+				return order < 0 || ( 0 == order && a_->line < b_->line );
+			} );
+			return sites;
+		}
+
+		size_t EnableCallSites( char const * pattern_, bool enable_ )
+		{
+			size_t matched = 0;
+			std::lock_guard< std::mutex > lock( GetCallSiteMutex() );
+			for ( CallSite * i = g_callSites; i; i = i->next )
+			{
+				std::string const line = ":" + std::to_string( i->line );
+				if ( GlobMatch( pattern_, ( i->file + line ).c_str() ) || GlobMatch( pattern_, ( GetBaseName( i->file ) + line ).c_str() ) )
+				{
+					i->Enable( enable_ );
+					++matched;
+				}
+			}
+			return matched;
+		}
+	}
+}
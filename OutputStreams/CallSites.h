@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	CallSites.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Per call site enable flags, switched at runtime by file and line pattern
+///
+///				 STREAM_SITE and STREAM_SITE_OFF begin a line guarded by a flag belonging to that one statement, starting enabled
+///				 and disabled respectively. Each site's flag lives in a static member of a class template instantiated with a
+///				 class local to the statement, so the flag is constant initialized and every site registers itself during static
+///				 initialisation, before it is first reached. A disabled site costs one load and one branch and its arguments are
+///				 not evaluated:
+///
+///					STREAM_SITE_OFF( channel ) << "request headers " << DumpHeaders( request ) << endl;
+///					...
+///					EnableCallSites( "*Server.cpp:*", true );
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef CallSites_DEFINED_19_10_2026
+#define CallSites_DEFINED_19_10_2026
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mbp
+{
+	namespace streams
+	{
+		struct CallSite
+		{
+			char const * file;
+			int line;
+			std::atomic< uint8_t > enabled;
+			CallSite * next;
+
+			bool IsEnabled() const { return 0 != enabled.load( std::memory_order_relaxed ); }
+			void Enable( bool enable_ ) { enabled.store( enable_ ? 1 : 0, std::memory_order_relaxed ); }
+		};
+
+		// called during static initialisation by every site, and by sites in shared libraries as they load
+		void RegisterCallSite( CallSite * site_ );
+		// called during static destruction, so a shared library's sites are forgotten as it unloads
+		void UnregisterCallSite( CallSite * site_ );
+		// every registered site, ordered by file and line
+		std::vector< CallSite * > GetCallSites();
+		// enables or disables the sites whose "file:line" matches a glob pattern ( * and ? ), trying both the file name as compiled and its base
+		// name. Returns the number of sites matched.
+		size_t EnableCallSites( char const * pattern_, bool enable_ );
+
+		template< typename SITE_ >
+		struct CallSiteHolder_t
+		{
+			static inline CallSite s_site{ SITE_::File(), SITE_::Line(), SITE_::kEnabled, nullptr };
+			struct Registrar
+			{
+				Registrar() { RegisterCallSite( &s_site ); }
+				~Registrar() { UnregisterCallSite( &s_site ); }
+			};
+			static inline Registrar s_registrar;
+		};
+	}
+}
+
+#if defined( STREAM_OUTPUT_STRIP )
+#define STREAM_SITE_IMPL( stream_, enabled_ ) if constexpr ( true ) {} else ( stream_ )
+#else
+// the site's class is declared in the if statement's initialiser, naming the registrar instantiates it without generating any code
+#define STREAM_SITE_IMPL( stream_, enabled_ ) \
+	if ( struct StreamSite { static constexpr char const * File() { return __FILE__; } static constexpr int Line() { return __LINE__; } enum : uint8_t { kEnabled = ( enabled_ ) }; }; \
+		( void )&::mbp::streams::CallSiteHolder_t< StreamSite >::s_registrar, !::mbp::streams::CallSiteHolder_t< StreamSite >::s_site.IsEnabled() ) {} else ( stream_ )
+#endif // #if defined( STREAM_OUTPUT_STRIP )
+
+#define STREAM_SITE( stream_ ) STREAM_SITE_IMPL( stream_, 1 )
+#define STREAM_SITE_OFF( stream_ ) STREAM_SITE_IMPL( stream_, 0 )
+
+#endif // #ifndef CallSites_DEFINED_19_10_2026
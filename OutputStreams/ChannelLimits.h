@@ -0,0 +1,141 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	ChannelLimits.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Per Channel ID rate limits and sampling, shared by every OutputChannel using the ID
+///
+///				 Rates are enforced with the generic cell rate algorithm: each limit is a single "theoretical arrival time" advanced
+///				 by a compare exchange, equivalent to a token bucket holding one second's allowance but with no refill step and no lock.
+///				 Sampling and the line rate are decided by a line's first character, so the rest of a dropped line is discarded as it
+///				 is written rather than buffered. The byte rate can only be decided once the line is complete.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef ChannelLimits_DEFINED_19_10_2026
+#define ChannelLimits_DEFINED_19_10_2026
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "OutputMetrics.h"
+
+namespace mbp
+{
+	namespace streams
+	{
+		// zero disables a limit
+		struct ChannelLimits
+		{
+			uint32_t linesPerSecond = 0;
+			uint64_t bytesPerSecond = 0;
+			uint32_t sampleEvery = 0;			// keep one line in every sampleEvery
+			std::chrono::milliseconds summaryPeriod{ 1000 };	// the minimum time between suppressed line summaries
+			uint64_t ( *clock )() = nullptr;	// nanoseconds for every limit and summary, GetMetricsClockNanoseconds() if nullptr
+		};
+
+		class ChannelLimiter
+		{
+		public:
+			// starts a new summary period, so lines dropped under the old limits are not reported
+			void Configure( ChannelLimits const & limits_ )
+			{
+				m_clock.store( limits_.clock ? limits_.clock : &GetMetricsClockNanoseconds, std::memory_order_relaxed );
+				m_lineCost.store( limits_.linesPerSecond ? kBurstNanoseconds / limits_.linesPerSecond : 0, std::memory_order_relaxed );
+				m_bytesPerSecond.store( limits_.bytesPerSecond, std::memory_order_relaxed );
+				m_sampleEvery.store( limits_.sampleEvery > 1 ? limits_.sampleEvery : 0, std::memory_order_relaxed );
+				m_summaryPeriod.store( static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( limits_.summaryPeriod ).count() ), std::memory_order_relaxed );
+				m_lastSummary.store( Now(), std::memory_order_relaxed );
+				m_suppressed.store( 0, std::memory_order_relaxed );
+				m_sampled.store( 0, std::memory_order_relaxed );
+				m_sampleCount.store( 0, std::memory_order_relaxed );
+				m_lineArrival.store( 0, std::memory_order_relaxed );
+				m_byteArrival.store( 0, std::memory_order_relaxed );
+			}
+			bool IsLineLimited() const { return m_lineCost.load( std::memory_order_relaxed ) || m_sampleEvery.load( std::memory_order_relaxed ); }
+			bool IsLimited() const { return IsLineLimited() || m_bytesPerSecond.load( std::memory_order_relaxed ); }
+			// the limits' clock, in nanoseconds
+			uint64_t Now() const { return m_clock.load( std::memory_order_relaxed )(); }
+
+			// sampling, then the line rate. Lines dropped by sampling are counted apart from those suppressed by a rate.
+			bool AdmitLine( uint64_t nowNanoseconds_ )
+			{
+				uint32_t sampleEvery = m_sampleEvery.load( std::memory_order_relaxed );
+				if ( sampleEvery && 0 != m_sampleCount.fetch_add( 1, std::memory_order_relaxed ) % sampleEvery )
+				{
+					m_sampled.fetch_add( 1, std::memory_order_relaxed );
+					return false;
+				}
+				uint64_t cost = m_lineCost.load( std::memory_order_relaxed );
+				return !cost || Conform( m_lineArrival, nowNanoseconds_, cost );
+			}
+			bool AdmitBytes( uint64_t numBytes_, uint64_t nowNanoseconds_ )
+			{
+				uint64_t bytesPerSecond = m_bytesPerSecond.load( std::memory_order_relaxed );
+				return !bytesPerSecond || Conform( m_byteArrival, nowNanoseconds_, numBytes_ * kBurstNanoseconds / bytesPerSecond );
+			}
+
+			// returns true to one caller once a summary period has passed with lines dropped, handing it the counts and the time they cover
+			bool TakeSummary( uint64_t nowNanoseconds_, uint64_t & suppressed_, uint64_t & sampled_, uint64_t & elapsedNanoseconds_ )
+			{
+				if ( 0 == m_suppressed.load( std::memory_order_relaxed ) && 0 == m_sampled.load( std::memory_order_relaxed ) )
+					return false;
+				uint64_t last = m_lastSummary.load( std::memory_order_relaxed );
+				if ( nowNanoseconds_ < last + m_summaryPeriod.load( std::memory_order_relaxed ) || !m_lastSummary.compare_exchange_strong( last, nowNanoseconds_, std::memory_order_relaxed ) )
+					return false;
+				suppressed_ = m_suppressed.exchange( 0, std::memory_order_relaxed );
+				sampled_ = m_sampled.exchange( 0, std::memory_order_relaxed );
+				elapsedNanoseconds_ = nowNanoseconds_ - last;
+				return suppressed_ != 0 || sampled_ != 0;
+			}
+
+			// e.g. "channel 7: 183421 lines suppressed in last 1s", or "channel 7: 0 lines suppressed, 3000 sampled out in last 1s"
+			static std::string FormatSummary( int channelID_, uint64_t suppressed_, uint64_t sampled_, uint64_t elapsedNanoseconds_ )
+			{
+				uint64_t seconds = ( elapsedNanoseconds_ + kBurstNanoseconds / 2 ) / kBurstNanoseconds;
+				return "channel " + std::to_string( channelID_ ) + ": " + std::to_string( suppressed_ ) + " lines suppressed"
+					+ ( sampled_ ? ", " + std::to_string( sampled_ ) + " sampled out" : std::string() ) + " in last " + std::to_string( seconds ? seconds : 1 ) + "s";
+			}
+
+		private:
+			// every limit allows a burst of one second's worth
+			static uint64_t constexpr kBurstNanoseconds = 1000000000;
+
+			// admits the event unless the limit's arrival time is already more than a burst ahead of now. A single event costing more than a burst is
+			// admitted when the limit is idle, so oversized lines aren't starved forever.
+			bool Conform( std::atomic< uint64_t > & arrival_, uint64_t now_, uint64_t cost_ )
+			{
+				uint64_t arrival = arrival_.load( std::memory_order_relaxed );
+				uint64_t next;
+				do
+				{
+					uint64_t start = arrival > now_ ? arrival : now_;
+					if ( arrival > now_ && start + cost_ > now_ + kBurstNanoseconds )
+					{
+						m_suppressed.fetch_add( 1, std::memory_order_relaxed );
+						return false;
+					}
+					next = start + cost_;
+				} while ( !arrival_.compare_exchange_weak( arrival, next, std::memory_order_relaxed ) );
+				return true;
+			}
+
+			std::atomic< uint64_t ( * )() > m_clock{ &GetMetricsClockNanoseconds };
+			std::atomic< uint64_t > m_lineCost{ 0 };			// nanoseconds of allowance per line
+			std::atomic< uint64_t > m_bytesPerSecond{ 0 };
+			std::atomic< uint32_t > m_sampleEvery{ 0 };
+			std::atomic< uint64_t > m_summaryPeriod{ 0 };
+			std::atomic< uint64_t > m_lineArrival{ 0 };
+			std::atomic< uint64_t > m_byteArrival{ 0 };
+			std::atomic< uint64_t > m_sampleCount{ 0 };
+			std::atomic< uint64_t > m_suppressed{ 0 };		// lines dropped by a rate
+			std::atomic< uint64_t > m_sampled{ 0 };			// lines dropped by sampling
+			std::atomic< uint64_t > m_lastSummary{ 0 };
+		};
+	}
+}
+
+#endif // #ifndef ChannelLimits_DEFINED_19_10_2026
@@ -0,0 +1,58 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	CompiledFilter.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Compile-time priority filtering at the call site
+///
+///				 STREAM_OUTPUT_STRIP removes every line in a build. STREAM_COMPILED_FILTER removes only lines whose priority is lower
+///				 than it (a higher value, as with the runtime Filter manipulator), and STREAM_CHANNEL_COMPILED_FILTER overrides it for one
+///				 Channel ID. Lines written through STREAM_LINE are discarded with if constexpr, so a stripped line's arguments are never
+///				 evaluated and no code is generated for it, while the lines that remain are set to their priority as usual:
+///
+///					STREAM_CHANNEL_COMPILED_FILTER( NETWORK_LAYER, 2 )		// at global scope, before use
+///					...
+///					STREAM_LINE( channel, NETWORK_LAYER, 3 ) << "packet " << DumpPacket( packet ) << endl;	// stripped
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef CompiledFilter_DEFINED_19_10_2026
+#define CompiledFilter_DEFINED_19_10_2026
+
+#include "OutputStreams.h"
+
+// the lowest priority compiled in by default, kDefaultFilter keeps everything
+#if !defined( STREAM_COMPILED_FILTER )
+#define STREAM_COMPILED_FILTER ( ::mbp::streams::kDefaultFilter )
+#endif // #if !defined( STREAM_COMPILED_FILTER )
+
+namespace mbp
+{
+	namespace streams
+	{
+		template< int CHANNEL_ >
+		inline constexpr SettingsType kCompiledFilter = static_cast< SettingsType >( STREAM_COMPILED_FILTER );
+
+		template< int CHANNEL_, int PRIORITY_ >
+		constexpr bool IsCompiledOut()
+		{
+#if defined( STREAM_OUTPUT_STRIP )
+			return true;
+#else
+			return PRIORITY_ > kCompiledFilter< CHANNEL_ >;
+#endif // #if defined( STREAM_OUTPUT_STRIP )
+		}
+	}
+}
+
+// overrides the compiled filter for a Channel ID. Use at global scope, before any STREAM_LINE for the ID.
+#define STREAM_CHANNEL_COMPILED_FILTER( channelID_, filter_ ) \
+	template<> inline constexpr ::mbp::streams::SettingsType mbp::streams::kCompiledFilter< ( channelID_ ) > = static_cast< ::mbp::streams::SettingsType >( filter_ );
+
+// begins a line at the given priority, or discards the whole statement at compile time. Channel ID and priority must be constant expressions.
+#define STREAM_LINE( stream_, channelID_, priority_ ) \
+	if constexpr ( ::mbp::streams::IsCompiledOut< ( channelID_ ), ( priority_ ) >() ) {} else ( stream_ ) << ::mbp::streams::Priority( priority_ )
+
+#endif // #ifndef CompiledFilter_DEFINED_19_10_2026
@@ -0,0 +1,212 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	ControlBlock.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Creation and mapping of the shared memory control block, and attachment of channel and stream settings to it
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "ControlBlock.h"
+#include "OutputChannels.h"
+
+#include <cstring>
+#include <new>
+#include <string>
+#if defined( __linux )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // #if defined( __linux )
+
+namespace mbp
+{
+	namespace streams
+	{
+		namespace
+		{
+			std::atomic< ControlBlock * > g_controlBlock{ nullptr };
+			// protected by g_streamsMutex
+			std::string g_controlBlockName;
+			StreamSettingsMirror * g_streamMirrors = nullptr;
+
+#if defined( __linux )
+			ControlBlock * MapSharedObject( char const * name_, int flags_ )
+			{
+				int fd = shm_open( name_, flags_, 0600 );
+				if ( fd < 0 )
+					return nullptr;
+				void * mapping = MAP_FAILED;
+				struct stat status;
+				if ( ( flags_ & O_CREAT ) ? 0 == ftruncate( fd, sizeof( ControlBlock ) ) : ( 0 == fstat( fd, &status ) && static_cast< size_t >( status.st_size ) >= sizeof( ControlBlock ) ) )
+					mapping = mmap( nullptr, sizeof( ControlBlock ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+				close( fd );
+				return MAP_FAILED == mapping ? nullptr : static_cast< ControlBlock * >( mapping );
+			}
+#endif // #if defined( __linux )
+
+			// claims a free stream slot for a stream's settings, leaving them in the process if the block is full. Caller holds g_streamsMutex.
+			void MirrorStreamSettings( StreamSettingsMirror & mirror_, ControlBlock & block_ )
+			{
+				for ( ControlBlock::Stream & stream : block_.streams )
+				{
+					uint32_t state = ControlBlock::Stream::kFree;
+					if ( stream.state.load( std::memory_order_relaxed ) != state || !stream.state.compare_exchange_strong( state, ControlBlock::Stream::kClaimed, std::memory_order_acquire ) )
+						continue;
+					std::strncpy( stream.name, mirror_.name->c_str(), ControlBlock::kMaxNameLength - 1 );
+					stream.name[ ControlBlock::kMaxNameLength - 1 ] = 0;
+					stream.settings.CopyFrom( *mirror_.own );
+					stream.state.store( ControlBlock::Stream::kAttached, std::memory_order_release );
+					mirror_.shared.store( &stream.settings, std::memory_order_release );
+					return;
+				}
+			}
+		}
+
+		bool OpenControlBlock( char const * name_ )
+		{
+#if defined( __linux )
+			std::lock_guard< std::mutex > lock( g_streamsMutex );
+			if ( g_controlBlock.load( std::memory_order_relaxed ) )
+				return false;
+			ControlBlock * block = MapSharedObject( name_, O_CREAT | O_RDWR );
+			if ( !block )
+				return false;
+			block = new ( block ) ControlBlock;
+			block->magic.store( ControlBlock::kMagic, std::memory_order_release );
+			g_controlBlock.store( block, std::memory_order_release );
+			g_controlBlockName = name_;
+
+			// IDs in use and existing streams move their settings into the block now, other IDs when they are next used
+			for ( size_t i = 0; i < ControlBlock::kMaxChannels; ++i )
+			{
+				ChannelEntry * entry = g_channelRegistry.Find( i );
+				if ( entry && entry->refCount.load( std::memory_order_acquire ) )
+					MirrorChannelSettings( *entry, static_cast< int >( i ) );
+			}
+			for ( StreamSettingsMirror * i = g_streamMirrors; i; i = i->next )
+				MirrorStreamSettings( *i, *block );
+			return true;
+#else
+			( void )name_;
+			return false;
+#endif // #if defined( __linux )
+		}
+
+		void CloseControlBlock()
+		{
+#if defined( __linux )
+			std::lock_guard< std::mutex > lock( g_streamsMutex );
+			ControlBlock * block = g_controlBlock.load( std::memory_order_relaxed );
+			if ( !block )
+				return;
+			g_controlBlock.store( nullptr, std::memory_order_release );
+			for ( size_t i = 0; i < ControlBlock::kMaxChannels; ++i )
+			{
+				ChannelEntry * entry = g_channelRegistry.Find( i );
+				if ( !entry || entry->block.load( std::memory_order_relaxed ) != block )
+					continue;
+				entry->LockSettings();
+				if ( StreamSettings * shared = entry->shared.load( std::memory_order_relaxed ) )
+					entry->settings.CopyFrom( *shared );
+				entry->shared.store( nullptr, std::memory_order_release );
+				entry->block.store( nullptr, std::memory_order_release );
+				entry->UnlockSettings();
+			}
+			for ( StreamSettingsMirror * i = g_streamMirrors; i; i = i->next )
+			{
+				if ( StreamSettings * shared = i->shared.load( std::memory_order_relaxed ) )
+					i->own->CopyFrom( *shared );
+				i->shared.store( nullptr, std::memory_order_release );
+			}
+			// streamctl no longer recognises the block, even through a name it has already opened
+			block->magic.store( 0, std::memory_order_release );
+			shm_unlink( g_controlBlockName.c_str() );
+			g_controlBlockName.clear();
+#endif // #if defined( __linux )
+		}
+
+		ControlBlock * GetControlBlock()
+		{
+			return g_controlBlock.load( std::memory_order_acquire );
+		}
+
+		ControlBlock * MapControlBlock( char const * name_ )
+		{
+#if defined( __linux )
+			ControlBlock * block = MapSharedObject( name_, O_RDWR );
+			if ( block && ( ControlBlock::kMagic != block->magic.load( std::memory_order_acquire ) || ControlBlock::kVersion != block->version ) )
+			{
+				munmap( block, sizeof( ControlBlock ) );
+				return nullptr;
+			}
+			return block;
+#else
+			( void )name_;
+			return nullptr;
+#endif // #if defined( __linux )
+		}
+
+		StreamSettings * AttachChannelSettings( int channelID_, StreamSettings & initSettings_ )
+		{
+			ControlBlock * block = GetControlBlock();
+			if ( !block || channelID_ < 0 || static_cast< size_t >( channelID_ ) >= ControlBlock::kMaxChannels )
+				return nullptr;
+			ControlBlock::Channel & channel = block->channels[ channelID_ ];
+			channel.settings.CopyFrom( initSettings_ );
+			channel.attached.store( 1, std::memory_order_release );
+			return &channel.settings;
+		}
+
+		void MirrorChannelSettings( ChannelEntry & entry_, int channelID_ )
+		{
+			ControlBlock * block = g_controlBlock.load( std::memory_order_relaxed );
+			if ( entry_.block.load( std::memory_order_relaxed ) == block )
+				return;
+			// a channel writing the ID's first settings finishes first, so the block is given them
+			entry_.LockSettings();
+			entry_.shared.store( AttachChannelSettings( channelID_, entry_.settings ), std::memory_order_release );
+			entry_.block.store( block, std::memory_order_release );
+			entry_.UnlockSettings();
+		}
+
+		void AttachStreamSettings( StreamSettingsMirror & mirror_ )
+		{
+			std::lock_guard< std::mutex > lock( g_streamsMutex );
+			mirror_.prev = nullptr;
+			mirror_.next = g_streamMirrors;
+			if ( g_streamMirrors )
+				g_streamMirrors->prev = &mirror_;
+			g_streamMirrors = &mirror_;
+			if ( ControlBlock * block = g_controlBlock.load( std::memory_order_relaxed ) )
+				MirrorStreamSettings( mirror_, *block );
+		}
+
+		void DetachStreamSettings( StreamSettingsMirror & mirror_ )
+		{
+			std::lock_guard< std::mutex > lock( g_streamsMutex );
+			if ( mirror_.prev )
+				mirror_.prev->next = mirror_.next;
+			else
+				g_streamMirrors = mirror_.next;
+			if ( mirror_.next )
+				mirror_.next->prev = mirror_.prev;
+			mirror_.prev = mirror_.next = nullptr;
+
+			StreamSettings * shared = mirror_.shared.load( std::memory_order_relaxed );
+			ControlBlock * block = g_controlBlock.load( std::memory_order_relaxed );
+			if ( !shared || !block )
+				return;
+			for ( ControlBlock::Stream & stream : block->streams )
+				if ( &stream.settings == shared )
+				{
+					stream.state.store( ControlBlock::Stream::kFree, std::memory_order_release );
+					break;
+				}
+			mirror_.shared.store( nullptr, std::memory_order_release );
+		}
+	}
+}
@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	ControlBlock.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Optional shared memory mirror of the channel and stream settings, so another process can change them live
+///
+///				 Once OpenControlBlock() has been called, the settings of Channel IDs below kMaxChannels and of up to kMaxStreams
+///				 OutputStreams live in a POSIX shared memory object instead of the process's own memory, including channels and streams
+///				 that already exist. Streams are found by name, those not given one by their target's default name, such as "stdout",
+///				 or their generated metrics name. The output path reads settings exactly as before, with relaxed atomic loads through
+///				 a pointer, so there is no polling and a change made by streamctl takes effect on the next line:
+///
+///					OpenControlBlock( "/myserver" );		// early in main, before channels are created
+///					...
+///					streamctl /myserver channel 7 filter 3
+///
+///				 The block belongs to the process that opens it and is reinitialised each time it is opened. CloseControlBlock() moves
+///				 the settings back into the process and removes the name. The mapping is kept, since a line being written may still be
+///				 reading settings from it.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef ControlBlock_DEFINED_19_10_2026
+#define ControlBlock_DEFINED_19_10_2026
+
+#include "OutputStreams.h"
+
+namespace mbp
+{
+	namespace streams
+	{
+		struct ChannelEntry;
+
+		struct ControlBlock
+		{
+			static uint32_t constexpr kMagic = 0x4243534F;		// "OSCB"
+			static uint32_t constexpr kVersion = 1;
+			static size_t constexpr kMaxChannels = 1024;
+			static size_t constexpr kMaxStreams = 256;
+			static size_t constexpr kMaxNameLength = 64;
+
+			struct Channel
+			{
+				StreamSettings settings;
+				std::atomic< uint8_t > attached{ 0 };
+			};
+
+			struct Stream
+			{
+				enum : uint32_t { kFree, kClaimed, kAttached };
+				std::atomic< uint32_t > state{ kFree };
+				char name[ kMaxNameLength ]{};
+				StreamSettings settings;
+			};
+
+			// written last when the block is initialised, so a reader seeing it sees the rest
+			std::atomic< uint32_t > magic{ 0 };
+			uint32_t version = kVersion;
+			uint32_t numChannels = kMaxChannels;
+			uint32_t numStreams = kMaxStreams;
+			Channel channels[ kMaxChannels ];
+			Stream streams[ kMaxStreams ];
+		};
+
+		// creates or reinitialises the named shared memory object ( "/name" ) and moves the settings of existing channels and streams into it.
+		// Returns false if shared memory isn't available, or a block is already open.
+		bool OpenControlBlock( char const * name_ );
+		// moves the settings back out of the open block, as they are now, and unlinks its name
+		void CloseControlBlock();
+		// the block opened by this process, or nullptr
+		ControlBlock * GetControlBlock();
+		// maps another process's block for reading and writing, or returns nullptr if it doesn't exist or doesn't match this version
+		ControlBlock * MapControlBlock( char const * name_ );
+		// returns a Channel ID's settings in the open block, initialised from initSettings_, or nullptr
+		StreamSettings * AttachChannelSettings( int channelID_, StreamSettings & initSettings_ );
+		// attaches a Channel ID's entry to the open block, or records that the block doesn't cover the ID. Caller holds g_streamsMutex.
+		void MirrorChannelSettings( ChannelEntry & entry_, int channelID_ );
+	}
+}
+
+#endif // #ifndef ControlBlock_DEFINED_19_10_2026
@@ -0,0 +1,235 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	FlightRecorder.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Formatting of and recording into the FlightRecorder ring, and the registry of named recorders
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "FlightRecorder.h"
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#if defined( __linux )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // #if defined( __linux )
+
+namespace mbp
+{
+	namespace streams
+	{
+		static_assert( sizeof( FlightRecorder::Header ) == 64, "the header layout is documented and read by other processes" );
+		static_assert( sizeof( FlightRecorder::Slot ) == 16, "the slot layout is documented and read by other processes" );
+
+		namespace
+		{
+			uint32_t GetNumSlots( size_t capacityBytes_ )
+			{
+				uint32_t numSlots = 16;
+				while ( numSlots * FlightRecorder::kPayloadBytes < capacityBytes_ && numSlots < ( 1u << 30 ) )
+					numSlots <<= 1;
+				return numSlots;
+			}
+
+			std::mutex g_recordersMutex;
+			std::map< std::string, std::weak_ptr< FlightRecorder > > g_recorders;
+
+#if defined( __linux )
+			// a name like "/name" is a shared memory object, anything else a file
+			int OpenBacking( std::string const & name_, int flags_ )
+			{
+				if ( name_.size() > 1 && '/' == name_[ 0 ] && std::string::npos == name_.find( '/', 1 ) )
+					return shm_open( name_.c_str(), flags_, 0600 );
+				return open( name_.c_str(), flags_ | O_CLOEXEC, 0600 );
+			}
+#endif // #if defined( __linux )
+		}
+
+		size_t FlightRecorder::GetBytesNeeded( size_t capacityBytes_ )
+		{
+			return sizeof( Header ) + GetNumSlots( capacityBytes_ ) * kSlotBytes;
+		}
+
+		FlightRecorder::FlightRecorder( size_t capacityBytes_ )
+			: m_storage( new char[ GetBytesNeeded( capacityBytes_ ) ] )
+			, m_header( nullptr )
+			, m_slots( nullptr )
+		{
+			Format( m_storage.get(), GetBytesNeeded( capacityBytes_ ) );
+		}
+
+		FlightRecorder::FlightRecorder( void * memory_, size_t numBytes_, bool attach_ )
+			: m_header( nullptr )
+			, m_slots( nullptr )
+		{
+			if ( !attach_ )
+			{
+				Format( memory_, numBytes_ );
+				return;
+			}
+			Header * header = static_cast< Header * >( memory_ );
+			if ( numBytes_ < sizeof( Header ) || kMagic != header->magic || kVersion != header->version || kSlotBytes != header->slotBytes )
+				return;
+			uint32_t numSlots = header->numSlots;
+			if ( !numSlots || ( numSlots & ( numSlots - 1 ) ) || sizeof( Header ) + static_cast< size_t >( numSlots ) * kSlotBytes > numBytes_ )
+				return;
+			// pairs with the fence before the magic is written
+			std::atomic_thread_fence( std::memory_order_acquire );
+			m_header = header;
+			m_slots = static_cast< char * >( memory_ ) + sizeof( Header );
+		}
+
+		void FlightRecorder::Format( void * memory_, size_t numBytes_ )
+		{
+			if ( numBytes_ < sizeof( Header ) + 16 * kSlotBytes )
+				return;
+			// the largest power of two number of slots that fits
+			uint32_t numSlots = 16;
+			while ( sizeof( Header ) + 2ull * numSlots * kSlotBytes <= numBytes_ && numSlots < ( 1u << 30 ) )
+				numSlots <<= 1;
+			Header * header = new ( memory_ ) Header;
+			header->magic = 0;
+			header->version = kVersion;
+			header->slotBytes = kSlotBytes;
+			header->numSlots = numSlots;
+			header->next.store( 0, std::memory_order_relaxed );
+			std::memset( header->reserved, 0, sizeof( header->reserved ) );
+			m_slots = static_cast< char * >( memory_ ) + sizeof( Header );
+			m_header = header;
+			for ( uint64_t i = 0; i < numSlots; ++i )
+			{
+				Slot * slot = new ( GetSlot( i ) ) Slot;
+				slot->stamp.store( 0, std::memory_order_relaxed );
+				slot->length = 0;
+				slot->index = 0;
+				slot->count = 0;
+			}
+			// written last, so a reader seeing it sees the rest
+			std::atomic_thread_fence( std::memory_order_release );
+			header->magic = kMagic;
+		}
+
+		void FlightRecorder::Record( void const * data_, size_t numBytes_ )
+		{
+			if ( !m_header )
+				return;
+			size_t maxSlots = m_header->numSlots / 2 < 0xFFFF ? m_header->numSlots / 2 : 0xFFFF;
+			if ( numBytes_ > maxSlots * kPayloadBytes )
+				numBytes_ = maxSlots * kPayloadBytes;
+			uint16_t count = static_cast< uint16_t >( numBytes_ ? ( numBytes_ + kPayloadBytes - 1 ) / kPayloadBytes : 1 );
+			uint64_t sequence = m_header->next.fetch_add( count, std::memory_order_relaxed );
+			char const * bytes = static_cast< char const * >( data_ );
+			for ( uint16_t i = 0; i < count; ++i, ++sequence )
+			{
+				Slot * slot = GetSlot( sequence );
+				slot->stamp.store( 2 * sequence + 1, std::memory_order_relaxed );
+				std::atomic_thread_fence( std::memory_order_release );
+				slot->length = static_cast< uint32_t >( numBytes_ );
+				slot->index = i;
+				slot->count = count;
+				size_t length = numBytes_ - i * kPayloadBytes < kPayloadBytes ? numBytes_ - i * kPayloadBytes : kPayloadBytes;
+				std::memcpy( reinterpret_cast< char * >( slot ) + sizeof( Slot ), bytes + i * kPayloadBytes, length );
+				slot->stamp.store( 2 * sequence + 2, std::memory_order_release );
+			}
+		}
+
+		bool FlightRecorder::DumpToFile( char const * filename_ ) const
+		{
+			std::ofstream outFile( filename_, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc );
+			if ( !outFile.good() )
+				return false;
+			ForEach( [ &outFile ]( char const * data_, size_t numBytes_ ) { outFile.write( data_, static_cast< std::streamsize >( numBytes_ ) ); } );
+			outFile.close();
+			return !outFile.fail();
+		}
+
+		std::shared_ptr< FlightRecorder > AcquireFlightRecorder( std::string const & name_, size_t capacityBytes_ )
+		{
+			if ( name_.empty() )
+				return std::make_shared< FlightRecorder >( capacityBytes_ );
+			std::lock_guard< std::mutex > lock( g_recordersMutex );
+			std::weak_ptr< FlightRecorder > & entry = g_recorders[ name_ ];
+			std::shared_ptr< FlightRecorder > recorder = entry.lock();
+			if ( !recorder )
+			{
+				recorder = std::make_shared< FlightRecorder >( capacityBytes_ );
+				entry = recorder;
+			}
+			return recorder;
+		}
+
+		std::shared_ptr< FlightRecorder > OpenSharedFlightRecorder( std::string const & name_, size_t capacityBytes_ )
+		{
+#if defined( __linux )
+			std::lock_guard< std::mutex > lock( g_recordersMutex );
+			std::weak_ptr< FlightRecorder > & entry = g_recorders[ name_ ];
+			if ( std::shared_ptr< FlightRecorder > recorder = entry.lock() )
+				return recorder;
+			int desc = OpenBacking( name_, O_RDWR | O_CREAT );
+			if ( desc < 0 )
+				return nullptr;
+			size_t numBytes = FlightRecorder::GetBytesNeeded( capacityBytes_ );
+			struct stat status;
+			bool const existing = 0 == fstat( desc, &status ) && static_cast< size_t >( status.st_size ) == numBytes;
+			void * mapping = MAP_FAILED;
+			if ( existing || 0 == ftruncate( desc, static_cast< off_t >( numBytes ) ) )
+				mapping = mmap( nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED, desc, 0 );
+			close( desc );
+			if ( MAP_FAILED == mapping )
+				return nullptr;
+			FlightRecorder * recorder = existing ? new FlightRecorder( mapping, numBytes, true ) : nullptr;
+			if ( !recorder || !recorder->IsValid() )
+			{
+				delete recorder;
+				recorder = new FlightRecorder( mapping, numBytes, false );
+			}
+			std::shared_ptr< FlightRecorder > shared( recorder, [ mapping, numBytes ]( FlightRecorder * recorder_ )
+			{
+				delete recorder_;
+				munmap( mapping, numBytes );
+			} );
+			entry = shared;
+			return shared;
+#else
+			( void )name_;
+			( void )capacityBytes_;
+			return nullptr;
+#endif // #if defined( __linux )
+		}
+
+		std::shared_ptr< FlightRecorder const > MapFlightRecorder( std::string const & name_ )
+		{
+#if defined( __linux )
+			int desc = OpenBacking( name_, O_RDONLY );
+			if ( desc < 0 )
+				return nullptr;
+			struct stat status;
+			void * mapping = MAP_FAILED;
+			if ( 0 == fstat( desc, &status ) && status.st_size > 0 )
+				mapping = mmap( nullptr, static_cast< size_t >( status.st_size ), PROT_READ, MAP_SHARED, desc, 0 );
+			close( desc );
+			if ( MAP_FAILED == mapping )
+				return nullptr;
+			size_t numBytes = static_cast< size_t >( status.st_size );
+			// the ring is only ever read through this mapping
+			std::shared_ptr< FlightRecorder const > recorder( new FlightRecorder( mapping, numBytes, true ), [ mapping, numBytes ]( FlightRecorder const * recorder_ )
+			{
+				delete recorder_;
+				munmap( mapping, numBytes );
+			} );
+			return recorder->IsValid() ? recorder : nullptr;
+#else
+			( void )name_;
+			return nullptr;
+#endif // #if defined( __linux )
+		}
+	}
+}
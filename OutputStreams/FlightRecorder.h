@@ -0,0 +1,180 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	FlightRecorder.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Bounded in-memory ring of records that always holds the most recent output, used by OutputFlightRecorder_t
+///
+///				 The ring is a header followed by fixed size slots, and lives in whatever memory it is given, so it can equally be placed
+///				 in a shared or file backed mapping and read from outside the process:
+///
+///					Header	64 bytes	magic "OSFR", version, slot size in bytes, number of slots (a power of two), and the 64 bit
+///										sequence number of the next slot to be claimed
+///					Slot	slot size	64 bit stamp, 32 bit record length in bytes, 16 bit index of the slot within its record,
+///										16 bit number of slots in the record, then the slot's share of the record
+///
+///				 Slot s of the sequence lives at s modulo the number of slots. A producer claims the slots for its record with one atomic
+///				 add on the sequence, so any number of producers record concurrently without locking or waiting; the oldest records are
+///				 overwritten. Each slot's stamp works as a sequence lock: 2s + 1 while slot s is being written and 2s + 2 once it is
+///				 complete. Readers copy a record and keep it only if every stamp is complete and unchanged by the copy, so records in
+///				 progress, overwritten during the read or torn by a crash are skipped rather than returned damaged. A producer lapped by
+///				 the entire ring during its own copy can still spoil a newer record, which sizes the ring well beyond that.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef FlightRecorder_DEFINED_19_10_2026
+#define FlightRecorder_DEFINED_19_10_2026
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mbp
+{
+	namespace streams
+	{
+		class FlightRecorder
+		{
+		public:
+			static uint32_t constexpr kMagic = 0x5246534F;		// "OSFR"
+			static uint32_t constexpr kVersion = 1;
+			static size_t constexpr kSlotBytes = 128;
+			static size_t constexpr kDefaultCapacity = 4 * 1024 * 1024;
+
+			struct Header
+			{
+				uint32_t magic;
+				uint32_t version;
+				uint32_t slotBytes;
+				uint32_t numSlots;
+				std::atomic< uint64_t > next;
+				uint8_t reserved[ 40 ];
+			};
+			struct Slot
+			{
+				std::atomic< uint64_t > stamp;
+				uint32_t length;
+				uint16_t index;
+				uint16_t count;
+			};
+			static size_t constexpr kPayloadBytes = kSlotBytes - sizeof( Slot );
+
+			// the bytes a ring holding at least capacityBytes_ of slots needs, header included
+			static size_t GetBytesNeeded( size_t capacityBytes_ );
+
+			// allocates and owns a ring of at least capacityBytes_
+			explicit FlightRecorder( size_t capacityBytes_ = kDefaultCapacity );
+			// a ring in memory_ owned by the caller, numBytes_ long. Formats it, or with attach_ reads the one already there; see IsValid().
+			FlightRecorder( void * memory_, size_t numBytes_, bool attach_ );
+
+			// copies a record into the ring, never blocking. Records too long for half the ring are truncated.
+			void Record( void const * data_, size_t numBytes_ );
+
+			// calls visitor_( char const * data, size_t numBytes ) for each complete record from sequence from_ on, oldest first, and returns the
+			// sequence to carry on from. With stopAtPending_ it stops at the first record still being written rather than skipping it, so a reader
+			// following the ring picks it up next time.
+			template< typename VISITOR_ >
+			uint64_t ForEach( VISITOR_ && visitor_, uint64_t from_ = 0, bool stopAtPending_ = false ) const
+			{
+				if ( !m_header )
+					return from_;
+				std::vector< char > record;
+				uint64_t end = m_header->next.load( std::memory_order_acquire );
+				uint64_t sequence = end > m_header->numSlots ? end - m_header->numSlots : 0;
+				if ( sequence < from_ )
+					sequence = from_;
+				while ( sequence < end )
+				{
+					Slot first;
+					if ( !ReadSlot( sequence, first, nullptr ) )
+					{
+						if ( stopAtPending_ && IsPending( sequence ) )
+							return sequence;
+						++sequence;
+						continue;
+					}
+					// the oldest slot may be part way through a record
+					if ( first.index )
+					{
+						sequence += first.index < first.count ? first.count - first.index : 1;
+						continue;
+					}
+					record.resize( first.count * kPayloadBytes );
+					bool complete = first.length <= first.count * kPayloadBytes;
+					for ( uint16_t i = 0; complete && i < first.count; ++i )
+					{
+						Slot slot;
+						complete = ReadSlot( sequence + i, slot, record.data() + i * kPayloadBytes ) && slot.index == i && slot.count == first.count;
+						if ( !complete && stopAtPending_ && IsPending( sequence + i ) )
+							return sequence;
+					}
+					if ( complete )
+						visitor_( static_cast< char const * >( record.data() ), static_cast< size_t >( first.length ) );
+					sequence += first.count;
+				}
+				return sequence;
+			}
+
+			// writes every complete record, oldest first, to a new file. Returns false if it couldn't be written.
+			bool DumpToFile( char const * filename_ ) const;
+
+			bool IsValid() const { return nullptr != m_header; }
+			size_t GetCapacity() const { return m_header ? static_cast< size_t >( m_header->numSlots ) * kPayloadBytes : 0; }
+			// slots claimed since the ring was formatted
+			uint64_t GetSequence() const { return m_header ? m_header->next.load( std::memory_order_relaxed ) : 0; }
+
+		private:
+			void Format( void * memory_, size_t numBytes_ );
+			Slot * GetSlot( uint64_t sequence_ ) const
+			{
+				return reinterpret_cast< Slot * >( m_slots + ( sequence_ & ( m_header->numSlots - 1 ) ) * kSlotBytes );
+			}
+			// slot sequence_ has been claimed but not yet completed
+			bool IsPending( uint64_t sequence_ ) const
+			{
+				return GetSlot( sequence_ )->stamp.load( std::memory_order_acquire ) < 2 * sequence_ + 2;
+			}
+			// copies slot sequence_'s fields, and its payload if payload_ isn't null, returning false unless it was complete throughout
+			bool ReadSlot( uint64_t sequence_, Slot & fields_, char * payload_ ) const
+			{
+				Slot * slot = GetSlot( sequence_ );
+				uint64_t stamp = slot->stamp.load( std::memory_order_acquire );
+				if ( stamp != 2 * sequence_ + 2 )
+					return false;
+				fields_.length = slot->length;
+				fields_.index = slot->index;
+				fields_.count = slot->count;
+				if ( payload_ )
+					std::memcpy( payload_, reinterpret_cast< char const * >( slot ) + sizeof( Slot ), kPayloadBytes );
+				std::atomic_thread_fence( std::memory_order_acquire );
+				return slot->stamp.load( std::memory_order_relaxed ) == stamp && fields_.count;
+			}
+
+			std::unique_ptr< char[] > m_storage;	// when the ring is owned
+			Header * m_header;
+			char * m_slots;
+
+			FlightRecorder( FlightRecorder const & other_ ) = delete;
+			FlightRecorder & operator=( FlightRecorder const & other_ ) = delete;
+		};
+
+		// the named FlightRecorder shared by every target recording to it, created with capacityBytes_ by the first to ask. An empty name gives a
+		// recorder of its own.
+		std::shared_ptr< FlightRecorder > AcquireFlightRecorder( std::string const & name_, size_t capacityBytes_ = FlightRecorder::kDefaultCapacity );
+		// Opens a ring kept in a POSIX shared memory object ( "/name" ) or, for any other name, a file, so it outlives the process however it ends
+		// and can be read afterwards with streamtail. A valid ring of the same capacity already there is carried on rather than cleared, so a
+		// restarted process appends to its predecessor's last records. The recorder is shared under name_ as by AcquireFlightRecorder(). Returns
+		// nullptr if the mapping fails, and where shared memory isn't supported.
+		std::shared_ptr< FlightRecorder > OpenSharedFlightRecorder( std::string const & name_, size_t capacityBytes_ = FlightRecorder::kDefaultCapacity );
+		// maps another process's ring, or the ring a process left behind, for reading. Returns nullptr if there isn't a valid ring.
+		std::shared_ptr< FlightRecorder const > MapFlightRecorder( std::string const & name_ );
+	}
+}
+
+#endif // #ifndef FlightRecorder_DEFINED_19_10_2026
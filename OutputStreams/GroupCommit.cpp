@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	GroupCommit.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Leader and follower data syncs for GroupCommit, and the registry sharing one GroupCommit per file
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "GroupCommit.h"
+
+#include <map>
+#if defined ( _MSC_VER )
+#include "windows.h"
+#elif defined ( __linux )
+#include <fcntl.h>
+#include <unistd.h>
+#endif // #if defined ( _MSC_VER )
+
+namespace mbp
+{
+	namespace streams
+	{
+		GroupCommit::GroupCommit( std::string const & filename_ )
+			: m_filename( filename_ )
+			, m_written( 0 )
+			, m_durable( 0 )
+			, m_syncing( false )
+			, m_syncs( 0 )
+		{
+		}
+
+		bool GroupCommit::Commit( uint64_t ticket_ )
+		{
+			std::unique_lock< std::mutex > lock( m_mutex );
+			while ( m_durable < ticket_ )
+			{
+				if ( m_syncing )
+				{
+					m_synced.wait( lock );
+					continue;
+				}
+				// everything counted now was written before the sync starts, so is covered by it
+				uint64_t written = m_written.load( std::memory_order_acquire );
+				m_syncing = true;
+				lock.unlock();
+				bool synced = SyncFile();
+				lock.lock();
+				m_syncing = false;
+				if ( synced && written > m_durable )
+					m_durable = written;
+				m_synced.notify_all();
+				if ( !synced )
+					return false;
+			}
+			return true;
+		}
+
+		bool GroupCommit::SyncFile()
+		{
+			m_syncs.fetch_add( 1, std::memory_order_relaxed );
+#if defined ( _MSC_VER )
+			HANDLE file = CreateFileA( m_filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, NULL, NULL );
+			if ( file == INVALID_HANDLE_VALUE )
+				return false;
+			bool synced = FALSE != FlushFileBuffers( file );
+			CloseHandle( file );
+			return synced;
+#elif defined ( __linux )
+			// any descriptor for the file syncs its data, whichever descriptor wrote it
+			int desc = open( m_filename.c_str(), O_WRONLY | O_CLOEXEC );
+			if ( desc < 0 )
+				return false;
+			bool synced = 0 == fdatasync( desc );
+			close( desc );
+			return synced;
+#else
+			return true;
+#endif // #if defined ( _MSC_VER )
+		}
+
+		std::shared_ptr< GroupCommit > AcquireGroupCommit( std::string const & filename_ )
+		{
+			static std::mutex s_mutex;
+			static std::map< std::string, std::weak_ptr< GroupCommit > > s_commits;
+			std::lock_guard< std::mutex > lock( s_mutex );
+			std::weak_ptr< GroupCommit > & entry = s_commits[ filename_ ];
+			std::shared_ptr< GroupCommit > commit = entry.lock();
+			if ( !commit )
+			{
+				commit = std::make_shared< GroupCommit >( filename_ );
+				entry = commit;
+			}
+			return commit;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	GroupCommit.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Shares data syncs of a file between every writer waiting for durability at the same time, used by OutputFile_t
+///
+///				 Writers add the bytes they have written and are given a ticket, the file's write count once their data is in. Commit()
+///				 returns once a sync covering the ticket has completed. The first writer to arrive syncs everything written so far on
+///				 behalf of all of them; writers arriving meanwhile wait for it and, if their data was written after it started, share
+///				 the next one. A burst of writers needing durability costs one or two fdatasync() calls rather than one each.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef GroupCommit_DEFINED_19_10_2026
+#define GroupCommit_DEFINED_19_10_2026
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace mbp
+{
+	namespace streams
+	{
+		class GroupCommit
+		{
+		public:
+			explicit GroupCommit( std::string const & filename_ );
+
+			// returns the ticket for data just written
+			uint64_t Add( uint64_t numBytes_ ) { return m_written.fetch_add( numBytes_, std::memory_order_acq_rel ) + numBytes_; }
+			// waits until everything up to ticket_ is on disk. Returns false if the sync failed.
+			bool Commit( uint64_t ticket_ );
+
+			uint64_t GetSyncCount() const { return m_syncs.load( std::memory_order_relaxed ); }
+
+		private:
+			bool SyncFile();
+
+			std::string m_filename;
+			std::mutex m_mutex;
+			std::condition_variable m_synced;
+			std::atomic< uint64_t > m_written;
+			uint64_t m_durable;				// the write count covered by the last completed sync, under m_mutex
+			bool m_syncing;					// a writer is syncing on behalf of the others, under m_mutex
+			std::atomic< uint64_t > m_syncs;
+
+			GroupCommit( GroupCommit const & other_ ) = delete;
+			GroupCommit & operator=( GroupCommit const & other_ ) = delete;
+		};
+
+		// the GroupCommit for a file, shared by every target writing it
+		std::shared_ptr< GroupCommit > AcquireGroupCommit( std::string const & filename_ );
+	}
+}
+
+#endif // #ifndef GroupCommit_DEFINED_19_10_2026
@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	LineBatcher.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Holds complete lines back for publication together, the batching and blocks stage of ChannelBuffer_t
+///
+///				 Lines are appended to a single buffer in the order they arrive, and Add() says when the batch has reached one of its
+///				 thresholds. While a block is open no batch is due until the outermost block ends. The owner publishes and clears the
+///				 batch. Each batcher has a single writer.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef LineBatcher_DEFINED_19_10_2026
+#define LineBatcher_DEFINED_19_10_2026
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mbp
+{
+	namespace streams
+	{
+		// Per-producer batching for an OutputChannel. Complete, stamped lines are held in the channel's own buffer and published to its streams as
+		// one block, so a batch costs each stream one lock and one Output() rather than one per line. Lines stay intact and in the order the
+		// channel wrote them. A batch is published when it reaches any non-zero threshold, on PublishBatch() and when the channel is destroyed.
+		// There is no timer, so maxAge is the longest a batch waits between lines: its age is checked as the channel's next line ends, and an
+		// aged batch is published before that line whether or not the line itself is output. A channel that may fall silent with lines held
+		// should call PublishBatch() itself. Stream settings are checked when the batch is published.
+		struct BatchSettings
+		{
+			size_t maxLines = 0;
+			size_t maxBytes = 0;
+			std::chrono::microseconds maxAge{ 0 };
+			bool IsEnabled() const { return maxLines || maxBytes || maxAge.count(); }
+		};
+
+		template< typename ELEM_ >
+		class LineBatcher_t
+		{
+		public:
+			// lines already held are kept, callers publish them first
+			void SetBatching( BatchSettings const & batching_ )
+			{
+				m_batching = batching_;
+				if ( m_batching.maxBytes )
+					m_lines.reserve( m_batching.maxBytes / sizeof( ELEM_ ) + kSlack );
+			}
+			// forgets the settings and any open blocks, keeping the storage for the next owner
+			void Reset()
+			{
+				m_batching = BatchSettings();
+				m_blockDepth = 0;
+				Clear();
+			}
+			// lines are held rather than published while batching is enabled or a block is open
+			bool IsHolding() const { return m_blockDepth || m_batching.IsEnabled(); }
+
+			// true if lines are held beyond the age threshold, outside any block
+			bool IsAged() const
+			{
+				return m_numLines && 0 == m_blockDepth && m_batching.maxAge.count() && std::chrono::steady_clock::now() - m_start >= m_batching.maxAge;
+			}
+			// returns true once the batch is due
+			bool Add( ELEM_ const * line_, size_t length_ )
+			{
+				using clock = std::chrono::steady_clock;
+				if ( 0 == m_numLines && m_batching.maxAge.count() )
+					m_start = clock::now();
+				m_lines.append( line_, length_ );
+				++m_numLines;
+				return 0 == m_blockDepth && ( ( m_batching.maxLines && m_numLines >= m_batching.maxLines )
+					|| ( m_batching.maxBytes && m_lines.size() * sizeof( ELEM_ ) >= m_batching.maxBytes )
+					|| ( m_batching.maxAge.count() && clock::now() - m_start >= m_batching.maxAge ) );
+			}
+
+			// blocks may nest, the outermost decides stamping
+			void BeginBlock( bool stampLines_ )
+			{
+				if ( 0 == m_blockDepth++ )
+					m_blockStamps = stampLines_;
+			}
+			// returns true when the outermost block ends, and the batch is due whatever its thresholds
+			bool EndBlock() { return m_blockDepth && 0 == --m_blockDepth; }
+			bool IsStamping() const { return 0 == m_blockDepth || m_blockStamps; }
+
+			ELEM_ const * GetData() const { return m_lines.data(); }
+			size_t GetLength() const { return m_lines.size(); }
+			uint64_t GetNumLines() const { return m_numLines; }
+			void Clear()
+			{
+				m_lines.clear();
+				m_numLines = 0;
+			}
+
+		private:
+			// room for the line that crosses the byte threshold, so a reserved batch doesn't reallocate
+			static size_t constexpr kSlack = 256;
+
+			BatchSettings m_batching;
+			std::basic_string< ELEM_ > m_lines;		// stamped lines awaiting publication, in the order they were added
+			uint64_t m_numLines = 0;
+			std::chrono::steady_clock::time_point m_start;
+			uint32_t m_blockDepth = 0;
+			bool m_blockStamps = true;
+		};
+	}
+}
+
+#endif // #ifndef LineBatcher_DEFINED_19_10_2026
@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	LineDeduplicator.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Collapses runs of identical lines, used by OutputBuffer_t and ChannelBuffer_t
+///
+///				 Lines are compared by a 64 bit hash of their text, excluding any stamp, so only the hash of the previous line is kept.
+///				 A run of repeats is reported as a single "repeated N times" line when a different line arrives or, for a run still
+///				 going, when a repeat arrives after the window has expired. Each deduplicator has a single writer.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef LineDeduplicator_DEFINED_19_10_2026
+#define LineDeduplicator_DEFINED_19_10_2026
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace mbp
+{
+	namespace streams
+	{
+		class LineDeduplicator
+		{
+		public:
+			// a zero window disables deduplication, discarding any run in progress. Callers report it with TakeRepeats() first.
+			void SetWindow( std::chrono::milliseconds window_ )
+			{
+				m_window = static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( window_ ).count() );
+				m_hasLast = false;
+				m_repeats = 0;
+			}
+			bool IsEnabled() const { return 0 != m_window; }
+
+			// returns true if the line repeats the previous line within the window and should be dropped. Otherwise the line starts a new run and
+			// repeats_ is set to the length of the run it ends, to be reported before the line.
+			bool IsRepeat( void const * text_, size_t numBytes_, uint64_t nowNanoseconds_, uint64_t & repeats_ )
+			{
+				uint64_t hash = Hash( static_cast< unsigned char const * >( text_ ), numBytes_ );
+				if ( m_hasLast && hash == m_lastHash && nowNanoseconds_ - m_runStart < m_window )
+				{
+					++m_repeats;
+					return true;
+				}
+				repeats_ = m_repeats;
+				m_repeats = 0;
+				m_lastHash = hash;
+				m_hasLast = true;
+				m_runStart = nowNanoseconds_;
+				return false;
+			}
+			// ends the current run, returning its repeats for reporting
+			uint64_t TakeRepeats()
+			{
+				uint64_t repeats = m_repeats;
+				m_repeats = 0;
+				m_hasLast = false;
+				return repeats;
+			}
+
+			template< typename ELEM_ >
+			static std::basic_string< ELEM_ > FormatRepeats( uint64_t repeats_ )
+			{
+				std::string const text = "repeated " + std::to_string( repeats_ ) + ( 1 == repeats_ ? " time\n" : " times\n" );
+				return std::basic_string< ELEM_ >( text.begin(), text.end() );
+			}
+
+			// a multiply-rotate hash over eight bytes at a time, much cheaper than byte at a time hashes for typical line lengths
+			static uint64_t Hash( unsigned char const * bytes_, size_t numBytes_ )
+			{
+				uint64_t constexpr kMultiplier = 0x9E3779B97F4A7C15ull;
+				uint64_t hash = numBytes_ * kMultiplier;
+				uint64_t word;
+				for ( ; numBytes_ >= sizeof( word ); numBytes_ -= sizeof( word ), bytes_ += sizeof( word ) )
+				{
+					std::memcpy( &word, bytes_, sizeof( word ) );
+					hash = Mix( hash ^ word, kMultiplier );
+				}
+				if ( numBytes_ )
+				{
+					word = 0;
+					std::memcpy( &word, bytes_, numBytes_ );
+					hash = Mix( hash ^ word, kMultiplier );
+				}
+				return hash ^ ( hash >> 29 );
+			}
+
+		private:
+			static uint64_t Mix( uint64_t value_, uint64_t multiplier_ )
+			{
+				value_ *= multiplier_;
+				return ( value_ << 31 ) | ( value_ >> 33 );
+			}
+
+			uint64_t m_window = 0;
+			uint64_t m_lastHash = 0;
+			uint64_t m_runStart = 0;
+			uint64_t m_repeats = 0;
+			bool m_hasLast = false;
+		};
+	}
+}
+
+#endif // #ifndef LineDeduplicator_DEFINED_19_10_2026
@@ -10,29 +10,134 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include "OutputChannels.h"
+#include "ControlBlock.h"
 
 namespace mbp
 {
 	namespace streams
 	{
-		StreamSettings g_AllChannelSettings[ kMaxOutputChannels ]{};
-		uint8_t g_channelInitFlags[ kMaxOutputChannels ]{};
-		uint8_t g_streamInitFlags[ kPrime ]{};
-		void * g_allSharedStreams[ kPrime ]{};
-		
+		ChannelRegistry g_channelRegistry;
+		StreamRegistry g_streamRegistry;
 		std::mutex g_streamsMutex;
 
-		size_t GetIndexFromPointer( void * ptr_ )
+		namespace
 		{
-			size_t index = reinterpret_cast< ptrdiff_t >( ptr_ ) % kPrime;
-			bool found = false;
-			while ( !found )
+			// protected by g_streamsMutex
+			size_t g_firstFreeStreamIndex = kInvalidRegistryIndex;
+			size_t g_nextStreamIndex = 0;
+			// OutputChannel objects using any Channel ID
+			std::atomic< uint32_t > g_liveChannelCount{ 0 };
+			// shared by channels constructed with an ID outside the registry, so they still write. It is never mirrored in a control block.
+			ChannelEntry g_outOfRangeChannelEntry;
+
+			// allocates a Channel ID's entry if necessary, registers its metrics totals and moves its settings into the control block if one is
+			// open. Only the first use of an ID, or the first after the control block was opened, takes g_streamsMutex.
+			ChannelEntry * FindOrAllocateChannelEntry( int channelID_ )
+			{
+				ChannelEntry * entry = g_channelRegistry.Find( static_cast< size_t >( channelID_ ) );
+				if ( !entry || entry->totals.channelId.load( std::memory_order_acquire ) < 0 || entry->block.load( std::memory_order_acquire ) != GetControlBlock() )
+				{
+					std::lock_guard< std::mutex > lock( g_streamsMutex );
+					if ( !entry )
+						entry = g_channelRegistry.Allocate( static_cast< size_t >( channelID_ ) );
+					if ( !entry )
+						return nullptr;
+					if ( entry->totals.channelId.load( std::memory_order_relaxed ) < 0 )
+						RegisterMetrics( &entry->totals, channelID_ );
+					MirrorChannelSettings( *entry, channelID_ );
+				}
+				return entry;
+			}
+		}
+
+		size_t AllocateStreamIndex()
+		{
+			if ( kInvalidRegistryIndex != g_firstFreeStreamIndex )
 			{
-				if ( g_allSharedStreams[ index ] == nullptr || g_allSharedStreams[ index ] == ptr_ )
-					return index;
-				index = ++index % kPrime;
+				size_t index = g_firstFreeStreamIndex;
+				g_firstFreeStreamIndex = g_streamRegistry.Find( index )->nextFree;
+				return index;
 			}
-			return index;
+			if ( !g_streamRegistry.Allocate( g_nextStreamIndex ) )
+				return kInvalidRegistryIndex;
+			return g_nextStreamIndex++;
+		}
+
+		void FreeStreamIndex( size_t index_ )
+		{
+			g_streamRegistry.Find( index_ )->nextFree = g_firstFreeStreamIndex;
+			g_firstFreeStreamIndex = index_;
+		}
+
+		ChannelEntry * AcquireChannelEntry( int channelID_, StreamSettings & initSettings_ )
+		{
+			ChannelEntry * entry = FindOrAllocateChannelEntry( channelID_ );
+			if ( !entry )
+				entry = &g_outOfRangeChannelEntry;
+			// A live count is raised from zero by claiming kInitialising, and only released as one after the settings are written, so a channel
+			// joining a live count sees them and a channel arriving meanwhile waits for them
+			uint32_t count = entry->refCount.load( std::memory_order_acquire );
+			for ( ;; )
+			{
+				if ( ChannelEntry::kInitialising == count )
+				{
+					std::this_thread::yield();
+					count = entry->refCount.load( std::memory_order_acquire );
+				}
+				else if ( count )
+				{
+					if ( entry->refCount.compare_exchange_weak( count, count + 1, std::memory_order_acquire, std::memory_order_acquire ) )
+						break;
+				}
+				else if ( entry->refCount.compare_exchange_weak( count, ChannelEntry::kInitialising, std::memory_order_acquire, std::memory_order_acquire ) )
+				{
+					// a control block slot keeps the settings it was first given, so changes made there survive the ID falling idle
+					entry->LockSettings();
+					if ( !entry->configured || !entry->shared.load( std::memory_order_relaxed ) )
+						entry->GetSettings().CopyFrom( initSettings_ );
+					entry->configured = true;
+					entry->UnlockSettings();
+					entry->refCount.store( 1, std::memory_order_release );
+					break;
+				}
+			}
+			g_liveChannelCount.fetch_add( 1, std::memory_order_relaxed );
+			return entry;
+		}
+
+		void ReleaseChannelEntry( ChannelEntry * entry_ )
+		{
+			entry_->refCount.fetch_sub( 1, std::memory_order_acq_rel );
+			g_liveChannelCount.fetch_sub( 1, std::memory_order_relaxed );
+		}
+
+		void DetachSharedStream( void * stream_, size_t registryIndex_ )
+		{
+			std::lock_guard< std::mutex > lock( g_streamsMutex );
+			StreamEntry * entry = g_streamRegistry.Find( registryIndex_ );
+			if ( entry && entry->stream.load( std::memory_order_relaxed ) == stream_ )
+				entry->stream.store( nullptr, std::memory_order_release );
+		}
+
+		bool SetChannelLimits( int channelID_, ChannelLimits const & limits_ )
+		{
+			ChannelEntry * entry = FindOrAllocateChannelEntry( channelID_ );
+			if ( !entry )
+				return false;
+			entry->limiter.Configure( limits_ );
+			return true;
+		}
+
+		uint32_t GetChannelReferenceCount( int channelID_ )
+		{
+			ChannelEntry * entry = g_channelRegistry.Find( static_cast< size_t >( channelID_ ) );
+			uint32_t count = entry ? entry->refCount.load( std::memory_order_acquire ) : 0;
+			return ChannelEntry::kInitialising == count ? 0 : count;
+		}
+
+		uint32_t GetLiveChannelCount()
+		{
+			return g_liveChannelCount.load( std::memory_order_acquire );
 		}
 	}
 }
@@ -12,118 +12,378 @@
 #ifndef OutputChannels_DEFINED_31_07_2019
 #define OutputChannels_DEFINED_31_07_2019
 
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 #include <vector>
 #if defined(__linux)
 #include <cstring>
 #endif // #if defined(__linux)
 #include "OutputStreams.h"
+#include "BacktraceRing.h"
+#include "ChannelLimits.h"
+#include "LineBatcher.h"
 #include "assert.h"
 
 namespace mbp
 {
 	namespace streams
 	{
-		// arbitrary number of OutputChannels - required for channel settings which have to be accessible to all active threads
-		auto constexpr kMaxOutputChannels = 64;
-		// the maximum number of shared OutputStreams 
-		auto constexpr kMaxSharedStreams = 32;
-		// a prime number that's close to but larger than KMaxSharedStreams to use for pointer hashing and array capacity
-		auto constexpr kPrime = 37;
-
-		// array of priority and filter settings for each channel, indexed by Channel ID
-		extern StreamSettings g_AllChannelSettings[ kMaxOutputChannels ];
-		extern uint8_t g_channelInitFlags[ kMaxOutputChannels ];
-		// array of shared stream pointers and initialisation flags used to prevent new channels from performing reinitialisation when attaching to the same one
-		extern void * g_allSharedStreams[ kPrime ];
-		extern uint8_t g_streamInitFlags[ kPrime ];
-		// mutex protecting the above
+		// A growable array whose elements never move. Elements live in leaves of ( 1 << LEAF_BITS_ ) elements, found through a fixed directory
+		// of ( 1 << DIRECTORY_BITS_ ) leaf pointers. A leaf is allocated on first use by a writer holding g_streamsMutex, then published with
+		// release semantics, so readers index the array without locking and a sparse index costs one small leaf. Leaves are never freed, which
+		// leaves nothing to reclaim and lets static streams and channels be destroyed in any order.
+		template< typename T_, size_t LEAF_BITS_, size_t DIRECTORY_BITS_ >
+		class SegmentedArray_t
+		{
+		public:
+			static constexpr size_t kCapacity = size_t( 1 ) << ( LEAF_BITS_ + DIRECTORY_BITS_ );
+
+			// returns nullptr if the index is beyond kCapacity or its leaf has not been allocated yet
+			T_ * Find( size_t index_ )
+			{
+				if ( index_ >= kCapacity )
+					return nullptr;
+				T_ * pLeaf = m_leaves[ index_ >> LEAF_BITS_ ].load( std::memory_order_acquire );
+				return pLeaf ? pLeaf + ( index_ & kLeafMask ) : nullptr;
+			}
+
+			// allocates the element's leaf if necessary, returning nullptr if the index is beyond kCapacity. Caller holds g_streamsMutex.
+			T_ * Allocate( size_t index_ )
+			{
+				if ( index_ >= kCapacity )
+					return nullptr;
+				std::atomic< T_ * > & leaf = m_leaves[ index_ >> LEAF_BITS_ ];
+				T_ * pLeaf = leaf.load( std::memory_order_relaxed );
+				if ( !pLeaf )
+				{
+					pLeaf = new T_[ kLeafMask + 1 ];
+					leaf.store( pLeaf, std::memory_order_release );
+				}
+				return pLeaf + ( index_ & kLeafMask );
+			}
+
+		private:
+			static constexpr size_t kLeafMask = ( size_t( 1 ) << LEAF_BITS_ ) - 1;
+			std::atomic< T_ * > m_leaves[ size_t( 1 ) << DIRECTORY_BITS_ ]{};
+		};
+
+		struct ControlBlock;
+
+		// the channel settings, limits and number of OutputChannel objects using each Channel ID
+		struct ChannelEntry
+		{
+			// the settings in the shared memory control block, when one is open and covers the Channel ID
+			StreamSettings & GetSettings()
+			{
+				StreamSettings * pShared = shared.load( std::memory_order_acquire );
+				return pShared ? *pShared : settings;
+			}
+			// the value refCount holds while the first channel to use the ID while none are live writes its settings
+			static constexpr uint32_t kInitialising = 0x80000000u;
+			StreamSettings settings;
+			std::atomic< StreamSettings * > shared{ nullptr };
+			// serialises a channel writing the ID's first settings with the settings moving into or out of a control block
+			void LockSettings()
+			{
+				while ( settingsBusy.exchange( true, std::memory_order_acquire ) )
+					std::this_thread::yield();
+			}
+			void UnlockSettings() { settingsBusy.store( false, std::memory_order_release ); }
+			std::atomic< bool > settingsBusy{ false };
+			// the control block the entry was last attached to, or found not to cover its ID, so each ID is looked up once per block
+			std::atomic< ControlBlock * > block{ nullptr };
+			// the ID's settings have been set by a channel, protected by settingsBusy
+			bool configured = false;
+			ChannelLimiter limiter;
+			ChannelTotals totals;
+			std::atomic< uint32_t > refCount{ 0 };
+		};
+
+		// a shared stream and the number of connectors attached to it. The stream pointer is cleared if the stream is destroyed first.
+		struct StreamEntry
+		{
+			std::atomic< void * > stream{ nullptr };
+			uint32_t refCount = 0;
+			size_t nextFree = 0;	// links unused entries, so freeing and reusing indices never allocates
+		};
+
+		using ChannelRegistry = SegmentedArray_t< ChannelEntry, 6, 14 >;
+		using StreamRegistry = SegmentedArray_t< StreamEntry, 5, 11 >;
+
+		// Channel IDs must be within 0 ... ( kMaxOutputChannels - 1 ). Channels given an ID outside that range share one entry that is never
+		// mirrored in a control block.
+		auto constexpr kMaxOutputChannels = static_cast< int >( ChannelRegistry::kCapacity );
+		// the maximum number of OutputStreams attached to channels at any one time
+		auto constexpr kMaxSharedStreams = StreamRegistry::kCapacity;
+
+		// settings for each channel, indexed by Channel ID
+		extern ChannelRegistry g_channelRegistry;
+		// shared streams, indexed by the registry index each stream holds while channels are attached to it
+		extern StreamRegistry g_streamRegistry;
+		// mutex serialising registration and removal in both of the above. Readers never take it.
 		extern std::mutex g_streamsMutex;
-		// hash and probe function
-		size_t GetIndexFromPointer( void * ptr_ );
 
-		template < typename ELEM_, template< typename > typename STREAMBASE_, bool MULTITHREAD_ >
-		class ChannelBuffer_t;
+		// allocation of shared stream indices, caller holds g_streamsMutex. AllocateStreamIndex returns kInvalidRegistryIndex when the registry is full.
+		size_t AllocateStreamIndex();
+		void FreeStreamIndex( size_t index_ );
+		// returns a Channel ID's entry and counts the channel as live. The first channel to use an ID while none are live sets its settings from
+		// initSettings_, unless they are already in a control block, and channels joining it wait until they are written. Only the first use of
+		// an ID, and its first use after a control block is opened or closed, take g_streamsMutex.
+		ChannelEntry * AcquireChannelEntry( int channelID_, StreamSettings & initSettings_ );
+		void ReleaseChannelEntry( ChannelEntry * entry_ );
+		// returns the number of OutputChannel objects currently using a Channel ID, and in total
+		uint32_t GetChannelReferenceCount( int channelID_ );
+		uint32_t GetLiveChannelCount();
+		// sets a Channel ID's rate limits and sampling, whether or not any OutputChannels use it yet. Channels already using the ID apply the
+		// new limits from their next line. Returns false if the ID is out of range.
+		bool SetChannelLimits( int channelID_, ChannelLimits const & limits_ );
 
-		// An OutputChannel uses a Channel ID and attaches to one or more OutputStreams, allowing per-channel filtering of output
-		template< typename ELEM_, template< typename > typename STREAMBASE_ >
-		class OutputChannel_t : public STREAMBASE_< ELEM_ >
+		// A list of streams resolved to their registry entries once, under g_streamsMutex. OutputChannels constructed from a connector share its
+		// entries and take their ChannelBuffers from a pool, so once the pool is warm they are constructed and destroyed without allocation, locking
+		// only to register their metrics. The streams are treated as channel targets for the connector's lifetime, and the connector must outlive
+		// every channel constructed from it.
+		template< typename ELEM_ >
+		class ChannelConnector_t
 		{
 		public:
-			OutputChannel_t( int channelID_, std::vector< BasicStream_t< ELEM_ > * > const& streams_, bool isMultiThreadChannel_ = true,  OutputStamp & stamp_ = OutputStamp::GetDummyStamp(), StreamSettings * initSettings_ = &GetDefaultChannelSettings() )
-				: STREAMBASE_< ELEM_ >( nullptr, initSettings_, stamp_ )
-				, m_channelId( channelID_ )
-				, m_sharedStreams( streams_ )
+			ChannelConnector_t() = default;
+			explicit ChannelConnector_t( std::vector< BasicStream_t< ELEM_ > * > const & streams_ )
 			{
-				assert( channelID_ < kMaxOutputChannels );
-				// create the correct ChannelBuffer for single or multi-thread usage
-				if ( isMultiThreadChannel_ )
-					BasicStream_t< ELEM_ >::rdbuf( new ChannelBuffer_t< ELEM_, STREAMBASE_, true >( *this, m_sharedStreams ) );
-				else
-					BasicStream_t< ELEM_ >::rdbuf( new ChannelBuffer_t< ELEM_, STREAMBASE_, false >( *this, m_sharedStreams ) );
-
 				g_streamsMutex.lock();
-				if ( 0 == g_channelInitFlags[ channelID_ ]++ )
-				{
-					g_AllChannelSettings[ channelID_ ].Enable( initSettings_->GetEnable() );
-					g_AllChannelSettings[ channelID_ ].SetPriority( initSettings_->GetPriority() );
-					g_AllChannelSettings[ channelID_ ].SetDefaultPriority( initSettings_->GetDefaultPriority() );
-					g_AllChannelSettings[ channelID_ ].SetFilter( initSettings_->GetFilter() );
-				}
-				for ( auto *& i : m_sharedStreams )
+				for ( auto * i : streams_ )
 				{
-					size_t index = GetIndexFromPointer( i );
-					g_allSharedStreams[ index ] = i;
-					if ( 0 == g_streamInitFlags[ index ]++ )
+					size_t index = i->GetRegistryIndex();
+					if ( kInvalidRegistryIndex == index )
+					{
+						index = AllocateStreamIndex();
+						// a full registry is reported in debug builds, release builds skip the stream
+						assert( kInvalidRegistryIndex != index );
+						if ( kInvalidRegistryIndex == index )
+							continue;
+						i->SetRegistryIndex( index );
+					}
+					StreamEntry * entry = g_streamRegistry.Find( index );
+					if ( 0 == entry->refCount++ )
 					{
+						entry->stream.store( i, std::memory_order_release );
 						i->SetIsChannelTarget( true );
 						BasicBuffer_t< ELEM_ > * buff = static_cast< BasicBuffer_t< ELEM_ > * >( i->rdbuf() );
 						buff->SetOriginalBufferStart();
 					}
+					m_entries.push_back( entry );
+					m_indices.push_back( index );
 				}
 				g_streamsMutex.unlock();
 			}
-			virtual ~OutputChannel_t()
+			~ChannelConnector_t()
 			{
-				size_t index;
-				delete BasicStream_t< ELEM_ >::rdbuf();
+				if ( m_entries.empty() )
+					return;
+				g_streamsMutex.lock();
+				for ( size_t i = 0; i < m_entries.size(); ++i )
 				{
-					g_streamsMutex.lock();
-					--g_channelInitFlags[ m_channelId ];
-					for ( auto *& i : m_sharedStreams )
+					StreamEntry * entry = m_entries[ i ];
+					if ( 0 == --entry->refCount )
 					{
-						index = GetIndexFromPointer( i );
-						if ( 1 == g_streamInitFlags[ index ]-- )
+						// restore the stream's own OutputStamp, unless it has already been destroyed
+						auto * strm = reinterpret_cast< BasicStream_t< ELEM_ > * >( entry->stream.load( std::memory_order_relaxed ) );
+						if ( strm )
 						{
-							g_allSharedStreams[ index ] = nullptr;
-							i->SetIsChannelTarget( false );
-							BasicBuffer_t< ELEM_ > * buff = static_cast< BasicBuffer_t< ELEM_ > * >( i->rdbuf() );
-							buff->ReserveStamp( *i );
+							strm->SetIsChannelTarget( false );
+							strm->SetRegistryIndex( kInvalidRegistryIndex );
+							BasicBuffer_t< ELEM_ > * buff = static_cast< BasicBuffer_t< ELEM_ > * >( strm->rdbuf() );
+							buff->ReserveStamp( *strm );
 						}
+						entry->stream.store( nullptr, std::memory_order_relaxed );
+						FreeStreamIndex( m_indices[ i ] );
+					}
+				}
+				g_streamsMutex.unlock();
+			}
+			std::vector< StreamEntry * > const & GetEntries() const { return m_entries; }
+		private:
+			std::vector< StreamEntry * > m_entries;
+			std::vector< size_t > m_indices;
+			ChannelConnector_t( ChannelConnector_t const & other_ ) = delete;
+			ChannelConnector_t operator=( ChannelConnector_t const & other_ ) = delete;
+		};
+
+		// A small lock-free pool of recycled objects. Each slot is emptied with an exchange and refilled with a compare exchange from empty, so a
+		// slot can never be claimed twice and there is no ABA hazard. Pooled objects are deleted at exit, and objects given back after that are
+		// refused so their owners delete them.
+		template< typename T_, size_t SIZE_ = 16 >
+		class RecyclePool_t
+		{
+		public:
+			static T_ * Take()
+			{
+				for ( auto & i : s_slots )
+				{
+					if ( i.load( std::memory_order_relaxed ) )
+					{
+						T_ * object = i.exchange( nullptr, std::memory_order_acquire );
+						if ( object )
+							return object;
 					}
-					g_streamsMutex.unlock();
 				}
+				return nullptr;
+			}
+			// returns false if the pool is full and the caller keeps ownership
+			static bool Give( T_ * object_ )
+			{
+				if ( s_drain.closed.load( std::memory_order_relaxed ) )
+					return false;
+				for ( auto & i : s_slots )
+				{
+					T_ * expected = nullptr;
+					if ( !i.load( std::memory_order_relaxed ) && i.compare_exchange_strong( expected, object_, std::memory_order_release, std::memory_order_relaxed ) )
+						return true;
+				}
+				return false;
+			}
+		private:
+			struct Drain
+			{
+				~Drain()
+				{
+					closed.store( true, std::memory_order_relaxed );
+					while ( T_ * object = Take() )
+						delete object;
+				}
+				std::atomic< bool > closed{ false };
+			};
+			static inline std::atomic< T_ * > s_slots[ SIZE_ ]{};
+			static inline Drain s_drain;
+		};
+
+		// Backtrace buffering for an OutputChannel. Lines held back by the channel's priority filter are stamped and kept in a ring of the last
+		// numLines instead of being dropped. When a line of triggerPriority or higher is output, the kept lines are published just before it, as
+		// one block, so an error arrives with the detail that led up to it. Kept lines are formatted, which filtered lines otherwise need not
+		// be, but only the lines around a trigger are written. Like batching, this belongs to the channel object and the thread using it.
+		struct BacktraceSettings
+		{
+			size_t numLines = 0;
+			SettingsType triggerPriority = kPriorityMax;
+			bool IsEnabled() const { return 0 != numLines; }
+		};
+
+		template < typename ELEM_, template< typename > typename STREAMBASE_, bool MULTITHREAD_ >
+		class ChannelBuffer_t;
+
+		// An OutputChannel uses a Channel ID and attaches to one or more OutputStreams, allowing per-channel filtering of output
+		template< typename ELEM_, template< typename > typename STREAMBASE_ >
+		class OutputChannel_t : public STREAMBASE_< ELEM_ >
+		{
+			using SharedBuffer = ChannelBuffer_t< ELEM_, STREAMBASE_, true >;
+		public:
+			OutputChannel_t( int channelID_, std::vector< BasicStream_t< ELEM_ > * > const& streams_, bool isMultiThreadChannel_ = true,  OutputStamp & stamp_ = OutputStamp::GetDummyStamp(), StreamSettings * initSettings_ = &GetDefaultChannelSettings() )
+				: STREAMBASE_< ELEM_ >( nullptr, initSettings_, stamp_ )
+				, m_channelId( channelID_ )
+				, m_ownConnector( streams_ )
+				, m_connector( m_ownConnector )
+				, m_isPooled( false )
+			{
+				Initialise( isMultiThreadChannel_, initSettings_ );
+			}
+			// the fast construction path, see ChannelConnector_t
+			OutputChannel_t( int channelID_, ChannelConnector_t< ELEM_ > const & connector_, bool isMultiThreadChannel_ = true, OutputStamp & stamp_ = OutputStamp::GetDummyStamp(), StreamSettings * initSettings_ = &GetDefaultChannelSettings() )
+				: STREAMBASE_< ELEM_ >( nullptr, initSettings_, stamp_ )
+				, m_channelId( channelID_ )
+				, m_connector( connector_ )
+				, m_isPooled( true )
+			{
+				Initialise( isMultiThreadChannel_, initSettings_ );
+			}
+			virtual ~OutputChannel_t()
+			{
+				m_buffer->Finish();
+				if ( m_isPooled )
+					m_buffer->Recycle();
+				else
+					delete m_buffer;
+				ReleaseChannelEntry( m_channelEntry );
 			}
 			// enable channel and filter functions for the shared stream (all threads)
-			virtual void Enable( SettingsType enable_ ) override { g_AllChannelSettings[ m_channelId ].Enable( enable_ ); }
-			virtual SettingsType GetEnable() override { return g_AllChannelSettings[ m_channelId ].GetEnable(); }
-			virtual void SetPriority( SettingsType newPriority_ ) override { g_AllChannelSettings[ m_channelId ].SetPriority( newPriority_ ); }
-			virtual SettingsType GetPriority() override { return g_AllChannelSettings[ m_channelId ].GetPriority(); }
+			virtual void Enable( SettingsType enable_ ) override { m_channelEntry->GetSettings().Enable( enable_ ); }
+			virtual SettingsType GetEnable() override { return m_channelEntry->GetSettings().GetEnable(); }
+			virtual void SetPriority( SettingsType newPriority_ ) override { m_channelEntry->GetSettings().SetPriority( newPriority_ ); }
+			virtual SettingsType GetPriority() override { return m_channelEntry->GetSettings().GetPriority(); }
 			virtual void SetDefaultPriority( SettingsType newDefault_ ) override {
-				g_AllChannelSettings[ m_channelId ].SetDefaultPriority( newDefault_ ); g_AllChannelSettings[ m_channelId ].SetPriority( newDefault_ );
+				m_channelEntry->GetSettings().SetDefaultPriority( newDefault_ ); m_channelEntry->GetSettings().SetPriority( newDefault_ );
 			}
-			virtual SettingsType GetDefaultPriority() override { return g_AllChannelSettings[ m_channelId ].GetDefaultPriority(); }
-			virtual void SetFilter( SettingsType newFilter_ ) override { g_AllChannelSettings[ m_channelId ].SetFilter( newFilter_ ); }
-			virtual SettingsType GetFilter() override { return g_AllChannelSettings[ m_channelId ].GetFilter(); }
+			virtual SettingsType GetDefaultPriority() override { return m_channelEntry->GetSettings().GetDefaultPriority(); }
+			virtual void SetFilter( SettingsType newFilter_ ) override { m_channelEntry->GetSettings().SetFilter( newFilter_ ); }
+			virtual SettingsType GetFilter() override { return m_channelEntry->GetSettings().GetFilter(); }
 			int const GetChannelId() const { return m_channelId; }
+			// the Channel ID's settings, shared by every OutputChannel using the same ID. Registry entries never move so this is resolved once.
+			StreamSettings & GetChannelSettings() { return m_channelEntry->GetSettings(); }
+			std::vector< StreamEntry * > const & GetStreamEntries() const { return m_connector.GetEntries(); }
+			ChannelMetrics & GetChannelMetrics() { return m_buffer->GetMetrics(); }
+			// the Channel ID's counts from channels already destroyed
+			ChannelTotals & GetChannelTotals() { return m_channelEntry->totals; }
+			// batching is per channel object and, like output, belongs to the thread using the channel
+			void SetBatching( BatchSettings const & batching_ ) { m_buffer->SetBatching( batching_ ); }
+			void PublishBatch() { m_buffer->PublishBatch(); }
+			// lines already kept are discarded, see BacktraceSettings
+			void SetBacktrace( BacktraceSettings const & backtrace_ ) { m_buffer->SetBacktrace( backtrace_ ); }
+			// Lines written while a Block is alive are held back and published together when it ends, with one lock and one write per stream, so
+			// no other channel's output can come between them. Each line is stamped unless stampLines_ is false. Blocks may nest, the outermost
+			// decides stamping and publishes.
+			class Block
+			{
+			public:
+				explicit Block( OutputChannel_t & channel_, bool stampLines_ = true )
+					: m_channel( channel_ )
+				{
+					m_channel.m_buffer->BeginBlock( stampLines_ );
+				}
+				~Block() { m_channel.m_buffer->EndBlock(); }
+			private:
+				OutputChannel_t & m_channel;
+				Block( Block const & other_ ) = delete;
+				Block & operator=( Block const & other_ ) = delete;
+			};
+			// collapses runs of identical lines from this channel, a zero window disables deduplication
+			void SetDeduplication( std::chrono::milliseconds window_ ) { m_buffer->SetDeduplication( window_ ); }
+			// reports a run of repeats still in progress now, rather than when the run ends
+			void FlushRepeats() { m_buffer->FlushRepeats(); }
+			// limits are per Channel ID, see SetChannelLimits
+			void SetLimits( ChannelLimits const & limits_ ) { SetChannelLimits( m_channelId, limits_ ); m_buffer->ArmAdmission(); }
+			ChannelLimiter & GetChannelLimiter() { return m_channelEntry->limiter; }
 		private:
+			void Initialise( bool isMultiThreadChannel_, StreamSettings * initSettings_ )
+			{
+				m_channelEntry = AcquireChannelEntry( m_channelId, *initSettings_ );
+				// create the correct ChannelBuffer for single or multi-thread usage
+				if ( isMultiThreadChannel_ )
+					m_buffer = CreateBuffer< true >();
+				else
+					m_buffer = CreateBuffer< false >();
+				m_buffer->Bind( *this );
+				BasicStream_t< ELEM_ >::rdbuf( m_buffer );
+			}
+			template< bool MULTITHREAD_ >
+			SharedBuffer * CreateBuffer()
+			{
+				using Buffer = ChannelBuffer_t< ELEM_, STREAMBASE_, MULTITHREAD_ >;
+				Buffer * buffer = m_isPooled ? RecyclePool_t< Buffer >::Take() : nullptr;
+				return buffer ? buffer : new Buffer();
+			}
 			int const m_channelId;
-			std::vector < BasicStream_t< ELEM_ > * > m_sharedStreams;
+			ChannelEntry * m_channelEntry;
+			ChannelConnector_t< ELEM_ > m_ownConnector;
+			ChannelConnector_t< ELEM_ > const & m_connector;
+			bool const m_isPooled;
+			SharedBuffer * m_buffer;
 			OutputChannel_t() = delete;
 			OutputChannel_t( OutputChannel_t const & other_ ) = delete;
 			OutputChannel_t operator=( OutputChannel_t const & other_ ) = delete;
 		};
 
-		// ChannelBuffer is an OutputChannel's buffer specialisation
+		// ChannelBuffer is an OutputChannel's buffer specialisation. Buffers are bound to a channel on construction of the channel and may be
+		// recycled through a RecyclePool_t, keeping their storage. Their metrics are registered for the life of the buffer, so binding and
+		// recycling a pooled buffer takes no lock and allocates nothing.
 		template < typename ELEM_, template< typename > typename STREAMBASE_, bool MULTITHREAD_ = true >
 		class ChannelBuffer_t : public std::basic_stringbuf< ELEM_, std::char_traits< ELEM_ >, std::allocator< ELEM_ > >
 		{
@@ -131,73 +391,385 @@ namespace mbp
 			using traits = std::char_traits < ELEM_ >;
 			using base = std::basic_stringbuf< ELEM_, traits, std::allocator< ELEM_ > >;
 		public:
-			ChannelBuffer_t( OutputChannel_t< ELEM_, STREAMBASE_ > & local_, std::vector< BasicStream_t< ELEM_ > * > & shared_ )
-				: m_localChannel( local_ )
+			ChannelBuffer_t()
+				: m_localChannel( nullptr )
+				, m_streamEntries( nullptr )
+				, m_batchPriority( kNoLinePriority )
+				, m_putEnd( nullptr )
+				, m_admissionPending( false )
+				, m_lineSuppressed( false )
+			{
+				RegisterMetrics( &m_metrics );
+			}
+			virtual ~ChannelBuffer_t()
+			{
+				if ( m_localChannel )
+					Unbind();
+				UnregisterMetrics( &m_metrics );
+			}
+			void Bind( OutputChannel_t< ELEM_, STREAMBASE_ > & local_ )
+			{
+				m_localChannel = &local_;
+				m_streamEntries = &local_.GetStreamEntries();
+				m_writesComplete.resize( m_streamEntries->size() );
+				m_combiningSlots.assign( m_streamEntries->size(), nullptr );
+				m_metrics.channelId.store( local_.GetChannelId(), std::memory_order_relaxed );
+				m_metrics.inUse.store( true, std::memory_order_relaxed );
+				m_batcher.Reset();
+				m_batchPriority = kNoLinePriority;
+				m_lineSuppressed = false;
+				m_dedup.SetWindow( std::chrono::milliseconds( 0 ) );
+				SetBacktrace( BacktraceSettings() );
+				// discard anything left unflushed by a previous channel and reserve space for this channel's stamp, a block at a time
+				OpenPutArea();
+				base::pbump( -static_cast< int >( base::pptr() - base::pbase() ) );
+				static std::basic_string< ELEM_ > const padding( 64, static_cast< ELEM_ >( 'C' ) );
+				for ( auto len = local_.GetOutputStamp().GetMaxLength(); len > 0; len -= 64 )
+					base::sputn( padding.data(), len < 64 ? len : 64 );
+				ArmAdmission();
+			}
+			// returns the buffer to its pool, or deletes it if the pool is full
+			virtual void Recycle()
+			{
+				Unbind();
+				if ( !RecyclePool_t< ChannelBuffer_t >::Give( this ) )
+					delete this;
+			}
+			ChannelMetrics & GetMetrics() { return m_metrics; }
+			// Drains the line policies when the channel is done with, in the order lines pass through them (see ProcessLine()): a run of repeats
+			// still in progress is reported, kept lines that never saw a trigger are discarded and count as filtered, and the batch is published.
+			void Finish()
+			{
+				FlushRepeats();
+				m_metrics.linesFiltered.Add( m_backtraceRing.Discard() );
+				PublishBatch();
+			}
+			// any lines already batched are published under the old settings
+			void SetBatching( BatchSettings const & batching_ )
+			{
+				PublishBatch();
+				m_batcher.SetBatching( batching_ );
+			}
+			// lines already kept are discarded and count as filtered
+			void SetBacktrace( BacktraceSettings const & backtrace_ )
 			{
-				for( auto *&i : shared_ )
+				m_backtrace = backtrace_;
+				m_metrics.linesFiltered.Add( m_backtraceRing.Resize( m_backtrace.numLines ) );
+			}
+			// While the Channel ID has line limits each line is left undecided, with the put area closed so its first character reaches overflow()
+			// and decides it. Only a line that hasn't been started is armed.
+			void ArmAdmission()
+			{
+				if ( m_admissionPending || m_lineSuppressed || !m_localChannel->GetChannelLimiter().IsLineLimited() )
+					return;
+				if ( base::pptr() - base::pbase() == m_localChannel->GetOutputStamp().GetMaxLength() )
 				{
-					m_streamIndices.push_back( GetIndexFromPointer( i ) );
+					m_admissionPending = true;
+					ClosePutArea();
 				}
-				auto len = local_.GetOutputStamp().GetMaxLength();
-				for ( auto i = 0; i < len; ++i )
+			}
+			void SetDeduplication( std::chrono::milliseconds window_ )
+			{
+				FlushRepeats();
+				m_dedup.SetWindow( window_ );
+			}
+			// reports a run of repeats still in progress
+			void FlushRepeats()
+			{
+				if ( uint64_t repeats = m_dedup.TakeRepeats() )
+					EmitRepeats( repeats );
+			}
+			// a block gathers lines in the batch and publishes them when the outermost block ends, whatever the batch thresholds
+			void BeginBlock( bool stampLines_ ) { m_batcher.BeginBlock( stampLines_ ); }
+			void EndBlock()
+			{
+				if ( m_batcher.EndBlock() )
+					PublishBatch();
+			}
+			void PublishBatch()
+			{
+				if ( m_batcher.GetNumLines() )
 				{
-					base::sputc( 'C' );
+					Publish( m_batcher.GetData(), m_batcher.GetLength(), m_batcher.GetNumLines(), m_batchPriority );
+					m_batcher.Clear();
+					m_batchPriority = kNoLinePriority;
 				}
 			}
-			virtual ~ChannelBuffer_t()	{}
 		protected:
-			virtual int sync() override
+			void Unbind()
+			{
+				m_metrics.inUse.store( false, std::memory_order_relaxed );
+				m_metrics.channelId.store( -1, std::memory_order_relaxed );
+				RetireMetrics( m_metrics, m_localChannel->GetChannelTotals() );
+				m_localChannel = nullptr;
+				m_streamEntries = nullptr;
+			}
+			// writes the stamp immediately before the line's text and returns its length. Multithread channels may share their stamp.
+			virtual int WriteStamp( int maxLength_ )
+			{
+				OutputStamp & stamp = m_localChannel->GetOutputStamp();
+				stamp.Lock();
+				int stampLength = stamp.GetLength();
+				stamp.WriteStamp( base::pbase() + maxLength_ - stampLength );
+				stamp.Unlock();
+				return stampLength;
+			}
+			// Writes one or more complete lines to every stream able to output them, taking each shared stream's lock without blocking on any one of
+			// them. Each stream commits the lines at priority_, the highest priority among them.
+			virtual void Publish( ELEM_ const * output_, size_t length_, uint64_t numLines_, int priority_ )
 			{
 				BasicStream_t< ELEM_ > * strm_;
-				int maxLength = 0;
-				int stampLength = 0;	
-				uint8_t writesComplete[ kMaxSharedStreams ];
-				auto numCharacters = base::pptr() - base::pbase();
-				if ( g_AllChannelSettings[ m_localChannel.GetChannelId() ].CanBeOutput() )
-				{
-					maxLength = m_localChannel.GetOutputStamp().GetMaxLength();
-					m_localChannel.GetOutputStamp().Lock();
-					stampLength = m_localChannel.GetOutputStamp().GetLength();
-					auto offset = maxLength - stampLength;
-					m_localChannel.GetOutputStamp().WriteStamp( base::pbase() + offset );
-					m_localChannel.GetOutputStamp().Unlock();
-					numCharacters -= maxLength;
-					for ( auto i = 0u; i < m_streamIndices.size(); ++i )
-						writesComplete[ i ] = 0;
-					int done, j;
-					do
+				for ( auto & i : m_writesComplete )
+					i = 0;
+				int done, j;
+				bool written = false;
+				uint64_t waitStart = 0;
+				do
+				{
+					j = 0;
+					done = 1;
+					for ( auto * i : *m_streamEntries )
 					{
-						j = 0;
-						done = 1;
-						for ( auto i : m_streamIndices )
+						if ( !m_writesComplete[ j ] )
 						{
-							if ( !writesComplete[ j ] )
+							strm_ = reinterpret_cast< BasicStream_t < ELEM_ > * >( i->stream.load( std::memory_order_acquire ) );
+							// a line posted to a combining stream is seen through even if the stream's settings change while it waits
+							if ( strm_ && ( m_combiningSlots[ j ] || strm_->GetSettings().CanBeOutput() ) )
 							{
-								strm_ = reinterpret_cast< BasicStream_t < ELEM_ > * >( g_allSharedStreams[ i ] );
-								if ( strm_ && strm_->m_settings.CanBeOutput() )
+								if ( TryWrite( *strm_, m_combiningSlots[ j ], output_, length_, priority_ ) )
 								{
-									if ( strm_->TryLock() )
-									{
-										strm_->write( base::pbase() + offset, numCharacters + stampLength );
-										strm_->flush();
-										strm_->Unlock();
-										++writesComplete[ j ];
-									}
+									++m_writesComplete[ j ];
+									written = true;
 								}
 								else
-									++writesComplete[ j ];
-								done &= writesComplete[ j++ ];
+								{
+									// contention is the slow path so only it pays for reading the clock
+									if ( 0 == waitStart )
+										waitStart = GetMetricsClockNanoseconds();
+									m_metrics.lockSpins.Add();
+								}
+							}
+							else
+							{
+								m_combiningSlots[ j ] = nullptr;
+								++m_writesComplete[ j ];
 							}
 						}
-					} while ( !done );
+						done &= m_writesComplete[ j++ ];
+					}
+				} while ( !done );
+				if ( waitStart )
+					m_metrics.lockWaitNanoseconds.Add( GetMetricsClockNanoseconds() - waitStart );
+				CountPublished( written, length_, numLines_ );
+			}
+			using CombiningSlot = typename BasicStream_t< ELEM_ >::CombiningSlot;
+			// one attempt at writing to a stream, through its combining slots if it has them and a free slot can be had
+			bool TryWrite( BasicStream_t< ELEM_ > & strm_, CombiningSlot *& slot_, ELEM_ const * output_, size_t length_, int priority_ )
+			{
+				if ( !slot_ && strm_.IsCombining() )
+					slot_ = strm_.PostCombined( output_, length_, priority_ );
+				if ( slot_ )
+				{
+					if ( !strm_.TryCombine( slot_ ) )
+						return false;
+					slot_ = nullptr;
+					return true;
 				}
+				if ( !strm_.TryLock() )
+					return false;
+				strm_.SetLinePriority( priority_ );
+				strm_.write( output_, length_ );
+				strm_.flush();
+				strm_.Unlock();
+				return true;
+			}
+			void CountPublished( bool written_, size_t length_, uint64_t numLines_ )
+			{
+				if ( written_ )
+				{
+					m_metrics.linesEmitted.Add( numLines_ );
+					m_metrics.bytes.Add( length_ * sizeof( ELEM_ ) );
+				}
+				else
+					m_metrics.linesFiltered.Add( numLines_ );
+			}
+			// the first character of an undecided line decides it, and every character of a suppressed line is discarded here
+			virtual typename traits::int_type overflow( typename traits::int_type c_ = traits::eof() ) override
+			{
+				if ( IsDiscarding() )
+					return traits::not_eof( c_ );
+				return base::overflow( c_ );
+			}
+			virtual std::streamsize xsputn( ELEM_ const * s_, std::streamsize n_ ) override
+			{
+				if ( n_ > 0 && IsDiscarding() )
+					return n_;
+				return base::xsputn( s_, n_ );
+			}
+			virtual int sync() override
+			{
+				auto maxLength = m_localChannel->GetOutputStamp().GetMaxLength();
+				// a line with no characters arrives here undecided
+				IsDiscarding();
+				OpenPutArea();
+				auto numCharacters = base::pptr() - base::pbase() - maxLength;
+				if ( m_batcher.IsAged() )
+					PublishBatch();
+				ProcessLine( maxLength, numCharacters );
+				m_lineSuppressed = false;
 				base::pbump( -static_cast< int >( numCharacters ) );
-				g_AllChannelSettings[ m_localChannel.GetChannelId() ].SetPriority( g_AllChannelSettings[ m_localChannel.GetChannelId() ].GetDefaultPriority() );
+				StreamSettings & channelSettings = m_localChannel->GetChannelSettings();
+				channelSettings.SetPriority( channelSettings.GetDefaultPriority() );
+				ArmAdmission();
 				return 0;
 			}
-			OutputChannel_t< ELEM_, STREAMBASE_ > & m_localChannel;
-			std::vector< size_t > m_streamIndices;
-			ChannelBuffer_t() = delete;
+			// Every complete line passes through the channel's line policies in this order, and any of them may end it:
+			//		limits		the Channel ID's sampling and line rate, decided by the line's first character in IsDiscarding()
+			//		dedup		a repeat of the previous line is counted rather than output, see LineDeduplicator
+			//		byte rate	the Channel ID's byte rate, which can only be applied to the complete line
+			//		backtrace	a line held back by priority is kept, and a trigger line publishes the kept lines before it, see BacktraceRing_t
+			//		batching	lines gather in the batch, and in any open block, until they are due, see LineBatcher_t
+			//		publish		lines are written to each stream, through its combining slots where it has them
+			// Finish() drains them in the same order.
+			void ProcessLine( int maxLength_, std::streamsize numCharacters_ )
+			{
+				StreamSettings & settings = m_localChannel->GetChannelSettings();
+				bool const canBeOutput = settings.CanBeOutput();
+				PublishSummary();
+				bool const dropped = m_lineSuppressed || ( canBeOutput && IsRepeat( maxLength_, numCharacters_ ) )
+					|| ( canBeOutput && !AdmitCompleteLine( numCharacters_ ) )
+					|| ( !canBeOutput && !IsKeptForBacktrace( settings ) );
+				if ( dropped )
+				{
+					m_metrics.linesFiltered.Add();
+					return;
+				}
+				int stampLength = m_batcher.IsStamping() ? WriteStamp( maxLength_ ) : 0;
+				ELEM_ const * line = base::pbase() + maxLength_ - stampLength;
+				size_t length = static_cast< size_t >( numCharacters_ + stampLength );
+				if ( !canBeOutput )
+					KeepLine( line, length );
+				else if ( m_backtraceRing.GetCount() && settings.GetPriority() <= m_backtrace.triggerPriority )
+					EmitBacktrace( line, length, settings.GetPriority() );
+				else
+					EmitLine( line, length, settings.GetPriority() );
+			}
+			// decides an undecided line, returning true while the line is suppressed. The put area stays closed for a suppressed line, so the rest
+			// of it is dropped by overflow() and xsputn() as it is written, whichever way it is written, and is never buffered.
+			bool IsDiscarding()
+			{
+				if ( m_admissionPending )
+				{
+					m_admissionPending = false;
+					StreamSettings & settings = m_localChannel->GetChannelSettings();
+					ChannelLimiter & limiter = m_localChannel->GetChannelLimiter();
+					// a filtered line kept for a backtrace is buffered, though never rate limited as it may never be output
+					if ( settings.CanBeOutput() ? limiter.AdmitLine( limiter.Now() ) : IsKeptForBacktrace( settings ) )
+						OpenPutArea();
+					else
+						m_lineSuppressed = true;
+				}
+				return m_lineSuppressed;
+			}
+			// closing the put area keeps its end, so the characters written so far stay where they are
+			void ClosePutArea()
+			{
+				if ( m_putEnd )
+					return;
+				auto used = base::pptr() - base::pbase();
+				m_putEnd = base::epptr();
+				base::setp( base::pbase(), base::pptr() );
+				base::pbump( static_cast< int >( used ) );
+			}
+			void OpenPutArea()
+			{
+				if ( !m_putEnd )
+					return;
+				auto used = base::pptr() - base::pbase();
+				base::setp( base::pbase(), m_putEnd );
+				base::pbump( static_cast< int >( used ) );
+				m_putEnd = nullptr;
+			}
+			// the byte rate can only be applied to a complete line
+			bool AdmitCompleteLine( std::streamsize numCharacters_ )
+			{
+				ChannelLimiter & limiter = m_localChannel->GetChannelLimiter();
+				return !limiter.IsLimited() || limiter.AdmitBytes( static_cast< uint64_t >( numCharacters_ ) * sizeof( ELEM_ ), limiter.Now() );
+			}
+			// true if the line, less its stamp, repeats the previous one and is dropped. A line ending a run of repeats reports the run first.
+			bool IsRepeat( int maxLength_, std::streamsize numCharacters_ )
+			{
+				if ( !m_dedup.IsEnabled() )
+					return false;
+				uint64_t repeats = 0;
+				if ( m_dedup.IsRepeat( base::pbase() + maxLength_, static_cast< size_t >( numCharacters_ ) * sizeof( ELEM_ ), GetMetricsClockNanoseconds(), repeats ) )
+					return true;
+				if ( repeats )
+					EmitRepeats( repeats );
+				return false;
+			}
+			void EmitRepeats( uint64_t repeats_ )
+			{
+				auto text = LineDeduplicator::FormatRepeats< ELEM_ >( repeats_ );
+				EmitLine( text.data(), text.size() );
+			}
+			// publishes the summary of suppressed lines once its period has passed, as any line ends, whether or not that line is admitted
+			void PublishSummary()
+			{
+				ChannelLimiter & limiter = m_localChannel->GetChannelLimiter();
+				uint64_t suppressed, sampled, elapsed;
+				if ( !limiter.IsLimited() || !limiter.TakeSummary( limiter.Now(), suppressed, sampled, elapsed ) )
+					return;
+				std::string const summary = ChannelLimiter::FormatSummary( m_localChannel->GetChannelId(), suppressed, sampled, elapsed );
+				std::basic_string< ELEM_ > line( summary.begin(), summary.end() );
+				line += static_cast< ELEM_ >( '\n' );
+				EmitLine( line.data(), line.size() );
+			}
+			// a line held back only by its priority is kept while backtrace buffering is on
+			bool IsKeptForBacktrace( StreamSettings & settings_ )
+			{
+				return m_backtraceRing.IsEnabled() && settings_.GetEnable();
+			}
+			// stores a stamped line in the backtrace ring, the oldest line dropped to make room counting as filtered
+			void KeepLine( ELEM_ const * line_, size_t length_ )
+			{
+				if ( m_backtraceRing.Keep( line_, length_ ) )
+					m_metrics.linesFiltered.Add();
+			}
+			// publishes the kept lines, oldest first, and then the line that triggered them, together at the trigger's priority
+			void EmitBacktrace( ELEM_ const * line_, size_t length_, int priority_ )
+			{
+				BeginBlock( true );
+				m_backtraceRing.Drain( [ this ]( ELEM_ const * kept_, size_t keptLength_ ) { EmitLine( kept_, keptLength_ ); } );
+				EmitLine( line_, length_, priority_ );
+				EndBlock();
+			}
+			// Publishes a complete line, or adds it to the batch, so lines of every kind keep their order. Lines the channel generates itself, such
+			// as repeat reports, have no priority of their own. A batch is published at the highest priority among its lines.
+			void EmitLine( ELEM_ const * line_, size_t length_, int priority_ = kNoLinePriority )
+			{
+				if ( !m_batcher.IsHolding() )
+					Publish( line_, length_, 1, priority_ );
+				else
+				{
+					m_batchPriority = std::min( m_batchPriority, priority_ );
+					if ( m_batcher.Add( line_, length_ ) )
+						PublishBatch();
+				}
+			}
+			OutputChannel_t< ELEM_, STREAMBASE_ > * m_localChannel;
+			std::vector< StreamEntry * > const * m_streamEntries;
+			std::vector< uint8_t > m_writesComplete;
+			std::vector< CombiningSlot * > m_combiningSlots;	// slots this buffer's current line is posted to, per stream
+			ChannelMetrics m_metrics;
+			LineBatcher_t< ELEM_ > m_batcher;
+			int m_batchPriority;				// the highest priority among the batched lines
+			BacktraceSettings m_backtrace;
+			BacktraceRing_t< ELEM_ > m_backtraceRing;
+			ELEM_ * m_putEnd;					// the end of the put area while it is closed, otherwise nullptr
+			bool m_admissionPending;			// the line hasn't been decided by the Channel ID's line limits yet
+			bool m_lineSuppressed;				// the line has been dropped by them
+			LineDeduplicator m_dedup;
 			ChannelBuffer_t( ChannelBuffer_t const & rhs_ ) = delete;
 			ChannelBuffer_t & operator = ( ChannelBuffer_t const & rhs_ ) = delete;
 		};
@@ -209,37 +781,100 @@ namespace mbp
 		public:
 			using base = ChannelBuffer_t< ELEM_, STREAMBASE_, true >;
 
-			ChannelBuffer_t( OutputChannel_t< ELEM_, STREAMBASE_ > & local_, std::vector< BasicStream_t< ELEM_ > * > & shared_ )
-				: ChannelBuffer_t< ELEM_, STREAMBASE_, true >( local_, shared_ )
+			ChannelBuffer_t()
 			{
 			}
 			virtual ~ChannelBuffer_t() {}
-			virtual int sync() override
+			virtual void Recycle() override
+			{
+				base::Unbind();
+				if ( !RecyclePool_t< ChannelBuffer_t >::Give( this ) )
+					delete this;
+			}
+		protected:
+			virtual int WriteStamp( int maxLength_ ) override
+			{
+				OutputStamp & stamp = base::m_localChannel->GetOutputStamp();
+				int stampLength = stamp.GetLength();
+				stamp.WriteStamp( base::pbase() + maxLength_ - stampLength );
+				return stampLength;
+			}
+			virtual void Publish( ELEM_ const * output_, size_t length_, uint64_t numLines_, int priority_ ) override
 			{
 				BasicStream_t< ELEM_ > * strm_;
-				 
-				auto maxLength = base::m_localChannel.GetOutputStamp().GetMaxLength();
-				auto stampLength = base::m_localChannel.GetOutputStamp().GetLength();
-				auto offset = maxLength - stampLength;
-				auto numCharacters = base::pptr() - base::pbase() - maxLength;
-
-				if ( g_AllChannelSettings[ base::m_localChannel.GetChannelId() ].CanBeOutput() )
+				bool written = false;
+				for ( auto * i : *base::m_streamEntries )
 				{
-					base::m_localChannel.GetOutputStamp().WriteStamp( base::pbase() + offset );
-					for ( auto i : base::m_streamIndices )
+					strm_ = reinterpret_cast< BasicStream_t < ELEM_ > * >( i->stream.load( std::memory_order_acquire ) );
+					if ( strm_ && strm_->GetSettings().CanBeOutput() )
 					{
-						strm_ = reinterpret_cast< BasicStream_t < ELEM_ > * >( g_allSharedStreams[ i ] );
-						if ( strm_->m_settings.CanBeOutput() )
-						{
-							strm_->write( base::pbase() + offset, numCharacters + stampLength );
-							strm_->flush();
-						}
+						strm_->SetLinePriority( priority_ );
+						strm_->write( output_, length_ );
+						strm_->flush();
+						written = true;
 					}
 				}
-				base::pbump( -static_cast< int >( numCharacters ) );
-				g_AllChannelSettings[ base::m_localChannel.GetChannelId() ].SetPriority( g_AllChannelSettings[ base::m_localChannel.GetChannelId() ].GetDefaultPriority() );
-				return 0;
+				base::CountPublished( written, length_, numLines_ );
+			}
+		};
+
+		// Periodically writes a metrics snapshot to one or more streams. Output goes through the dumper's own multithread OutputChannel so the
+		// streams can be shared with the application's channels. A zero period_ starts no thread, and snapshots are only written by Tick().
+		template< template< typename > typename STREAMBASE_ >
+		class MetricsDumper_t
+		{
+		public:
+			MetricsDumper_t( int channelID_, std::vector< BasicStream_t< char > * > const & streams_, std::chrono::milliseconds period_, MetricsFormat format_ = MetricsFormat::Text, OutputStamp & stamp_ = OutputStamp::GetDummyStamp() )
+				: m_channelId( channelID_ )
+				, m_streams( streams_ )
+				, m_period( period_ )
+				, m_format( format_ )
+				, m_stamp( stamp_ )
+				, m_stop( false )
+			{
+				if ( m_period.count() > 0 )
+					m_thread = std::thread( &MetricsDumper_t::Run, this );
+			}
+			~MetricsDumper_t()
+			{
+				if ( !m_thread.joinable() )
+					return;
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					m_stop = true;
+				}
+				m_wake.notify_one();
+				m_thread.join();
+			}
+			// writes a snapshot now, through a channel on the calling thread
+			void Tick()
+			{
+				OutputChannel_t< char, STREAMBASE_ > channel( m_channelId, m_streams, true, m_stamp );
+				WriteMetrics( channel, GetMetricsSnapshot(), m_format );
 			}
+		private:
+			void Run()
+			{
+				OutputChannel_t< char, STREAMBASE_ > channel( m_channelId, m_streams, true, m_stamp );
+				std::unique_lock< std::mutex > lock( m_mutex );
+				while ( !m_wake.wait_for( lock, m_period, [ this ] { return m_stop; } ) )
+				{
+					lock.unlock();
+					WriteMetrics( channel, GetMetricsSnapshot(), m_format );
+					lock.lock();
+				}
+			}
+			int const m_channelId;
+			std::vector< BasicStream_t< char > * > m_streams;
+			std::chrono::milliseconds const m_period;
+			MetricsFormat const m_format;
+			OutputStamp & m_stamp;
+			bool m_stop;
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::thread m_thread;
+			MetricsDumper_t( MetricsDumper_t const & other_ ) = delete;
+			MetricsDumper_t operator=( MetricsDumper_t const & other_ ) = delete;
 		};
 	}
 }
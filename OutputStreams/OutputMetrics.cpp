@@ -0,0 +1,210 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	OutputMetrics.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Metrics registration, snapshot aggregation and text / Prometheus formatting
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "OutputMetrics.h"
+
+#include <map>
+#include <mutex>
+
+namespace mbp
+{
+	namespace streams
+	{
+		std::mutex g_metricsMutex;
+
+		namespace
+		{
+			// protected by g_metricsMutex
+			StreamMetrics * g_streamMetrics = nullptr;
+			ChannelMetrics * g_channelMetrics = nullptr;
+			ChannelTotals * g_channelTotals = nullptr;
+			uint64_t g_unnamedStreamCount = 0;
+
+			template< typename T_ >
+			void Register( T_ *& head_, T_ * metrics_ )
+			{
+				metrics_->prev = nullptr;
+				metrics_->next = head_;
+				if ( head_ )
+					head_->prev = metrics_;
+				head_ = metrics_;
+			}
+
+			template< typename T_ >
+			void Unregister( T_ *& head_, T_ * metrics_ )
+			{
+				if ( metrics_->prev )
+					metrics_->prev->next = metrics_->next;
+				else
+					head_ = metrics_->next;
+				if ( metrics_->next )
+					metrics_->next->prev = metrics_->prev;
+				metrics_->prev = metrics_->next = nullptr;
+			}
+
+			std::string EscapeLabel( std::string const & value_ )
+			{
+				std::string escaped;
+				for ( auto c : value_ )
+				{
+					if ( c == '\\' || c == '"' )
+						escaped += '\\';
+					if ( c == '\n' )
+						escaped += "\\n";
+					else
+						escaped += c;
+				}
+				return escaped;
+			}
+
+			void WriteLine( std::ostream & out_, std::string const & line_ )
+			{
+				out_ << line_;
+				out_.rdbuf()->sputc( '\n' );
+				out_.flush();
+			}
+
+			template< typename ENTRY_ >
+			void WritePrometheusFamily( std::ostream & out_, std::vector< ENTRY_ > const & entries_, char const * name_, char const * type_, char const * help_
+				, std::string ( *label_ )( ENTRY_ const & ), uint64_t ( *value_ )( ENTRY_ const & ) )
+			{
+				if ( entries_.empty() )
+					return;
+				WriteLine( out_, std::string( "# HELP " ) + name_ + " " + help_ );
+				WriteLine( out_, std::string( "# TYPE " ) + name_ + " " + type_ );
+				for ( auto & i : entries_ )
+					WriteLine( out_, std::string( name_ ) + "{" + label_( i ) + "} " + std::to_string( value_( i ) ) );
+			}
+
+			std::string StreamLabel( MetricsSnapshot::Stream const & stream_ ) { return "stream=\"" + EscapeLabel( stream_.name ) + "\""; }
+			std::string ChannelLabel( MetricsSnapshot::Channel const & channel_ ) { return "channel=\"" + std::to_string( channel_.channelId ) + "\""; }
+		}
+
+		void RegisterMetrics( StreamMetrics * metrics_ )
+		{
+			std::lock_guard< std::mutex > lock( g_metricsMutex );
+			if ( metrics_->name.empty() )
+				metrics_->name = "stream" + std::to_string( g_unnamedStreamCount++ );
+			Register( g_streamMetrics, metrics_ );
+		}
+
+		void UnregisterMetrics( StreamMetrics * metrics_ )
+		{
+			std::lock_guard< std::mutex > lock( g_metricsMutex );
+			Unregister( g_streamMetrics, metrics_ );
+		}
+
+		void RegisterMetrics( ChannelMetrics * metrics_ )
+		{
+			std::lock_guard< std::mutex > lock( g_metricsMutex );
+			Register( g_channelMetrics, metrics_ );
+		}
+
+		void UnregisterMetrics( ChannelMetrics * metrics_ )
+		{
+			std::lock_guard< std::mutex > lock( g_metricsMutex );
+			Unregister( g_channelMetrics, metrics_ );
+		}
+
+		void RegisterMetrics( ChannelTotals * totals_, int channelId_ )
+		{
+			std::lock_guard< std::mutex > lock( g_metricsMutex );
+			totals_->channelId.store( channelId_, std::memory_order_relaxed );
+			totals_->next = g_channelTotals;
+			g_channelTotals = totals_;
+		}
+
+		void RetireMetrics( ChannelMetrics & metrics_, ChannelTotals & totals_ )
+		{
+			// each count is zeroed before it is folded in, so a concurrent snapshot may briefly miss it but never counts it twice
+			auto fold = []( MetricCounter & from_, SharedMetricCounter & to_ )
+			{
+				uint64_t count = from_.Get();
+				from_.Set( 0 );
+				to_.Add( count );
+			};
+			fold( metrics_.linesEmitted, totals_.linesEmitted );
+			fold( metrics_.linesFiltered, totals_.linesFiltered );
+			fold( metrics_.bytes, totals_.bytes );
+			fold( metrics_.lockSpins, totals_.lockSpins );
+			fold( metrics_.lockWaitNanoseconds, totals_.lockWaitNanoseconds );
+		}
+
+		MetricsSnapshot GetMetricsSnapshot()
+		{
+			MetricsSnapshot snapshot;
+			std::lock_guard< std::mutex > lock( g_metricsMutex );
+			for ( auto * i = g_streamMetrics; i; i = i->next )
+				snapshot.streams.push_back( { i->name, i->linesEmitted.Get(), i->linesFiltered.Get(), i->bytes.Get(), i->flushNanoseconds.Get(), i->targetErrors.Get() } );
+
+			std::map< int, MetricsSnapshot::Channel > channels;
+			for ( auto * i = g_channelTotals; i; i = i->next )
+			{
+				int channelId = i->channelId.load( std::memory_order_relaxed );
+				channels[ channelId ] = { channelId, 0, i->linesEmitted.Get(), i->linesFiltered.Get(), i->bytes.Get(), i->lockSpins.Get(), i->lockWaitNanoseconds.Get() };
+			}
+			for ( auto * i = g_channelMetrics; i; i = i->next )
+			{
+				int channelId = i->channelId.load( std::memory_order_relaxed );
+				if ( channelId < 0 )
+					continue;
+				auto & channel = channels[ channelId ];
+				channel.channelId = channelId;
+				if ( i->inUse.load( std::memory_order_relaxed ) )
+					++channel.liveChannels;
+				channel.linesEmitted += i->linesEmitted.Get();
+				channel.linesFiltered += i->linesFiltered.Get();
+				channel.bytes += i->bytes.Get();
+				channel.lockSpins += i->lockSpins.Get();
+				channel.lockWaitNanoseconds += i->lockWaitNanoseconds.Get();
+			}
+			for ( auto & i : channels )
+				snapshot.channels.push_back( i.second );
+			return snapshot;
+		}
+
+		void WriteMetrics( std::ostream & out_, MetricsSnapshot const & snapshot_, MetricsFormat format_ )
+		{
+			using Stream = MetricsSnapshot::Stream;
+			using Channel = MetricsSnapshot::Channel;
+			if ( format_ == MetricsFormat::Text )
+			{
+				for ( auto & i : snapshot_.streams )
+				{
+					WriteLine( out_, "stream " + i.name + " lines=" + std::to_string( i.linesEmitted ) + " filtered=" + std::to_string( i.linesFiltered )
+						+ " bytes=" + std::to_string( i.bytes ) + " flush_us=" + std::to_string( i.flushNanoseconds / 1000 ) + " errors=" + std::to_string( i.targetErrors ) );
+				}
+				for ( auto & i : snapshot_.channels )
+				{
+					WriteLine( out_, "channel " + std::to_string( i.channelId ) + " live=" + std::to_string( i.liveChannels ) + " lines=" + std::to_string( i.linesEmitted )
+						+ " filtered=" + std::to_string( i.linesFiltered ) + " bytes=" + std::to_string( i.bytes ) + " lock_spins=" + std::to_string( i.lockSpins )
+						+ " lock_wait_us=" + std::to_string( i.lockWaitNanoseconds / 1000 ) );
+				}
+				return;
+			}
+
+			auto const & streams = snapshot_.streams;
+			WritePrometheusFamily< Stream >( out_, streams, "outputstreams_stream_lines_total", "counter", "Lines passed to the stream's OutputTarget", StreamLabel, []( Stream const & s_ ) { return s_.linesEmitted; } );
+			WritePrometheusFamily< Stream >( out_, streams, "outputstreams_stream_lines_filtered_total", "counter", "Lines dropped by the stream's enable and filter settings", StreamLabel, []( Stream const & s_ ) { return s_.linesFiltered; } );
+			WritePrometheusFamily< Stream >( out_, streams, "outputstreams_stream_bytes_total", "counter", "Bytes passed to the stream's OutputTarget", StreamLabel, []( Stream const & s_ ) { return s_.bytes; } );
+			WritePrometheusFamily< Stream >( out_, streams, "outputstreams_stream_flush_nanoseconds_total", "counter", "Time spent inside the stream's OutputTarget", StreamLabel, []( Stream const & s_ ) { return s_.flushNanoseconds; } );
+			WritePrometheusFamily< Stream >( out_, streams, "outputstreams_stream_target_errors_total", "counter", "Failures reported by the stream's OutputTarget", StreamLabel, []( Stream const & s_ ) { return s_.targetErrors; } );
+
+			auto const & channels = snapshot_.channels;
+			WritePrometheusFamily< Channel >( out_, channels, "outputstreams_channel_live", "gauge", "OutputChannel objects currently using the channel ID", ChannelLabel, []( Channel const & c_ ) { return c_.liveChannels; } );
+			WritePrometheusFamily< Channel >( out_, channels, "outputstreams_channel_lines_total", "counter", "Lines published by the channel ID", ChannelLabel, []( Channel const & c_ ) { return c_.linesEmitted; } );
+			WritePrometheusFamily< Channel >( out_, channels, "outputstreams_channel_lines_filtered_total", "counter", "Lines dropped by the channel ID's settings or its streams' settings", ChannelLabel, []( Channel const & c_ ) { return c_.linesFiltered; } );
+			WritePrometheusFamily< Channel >( out_, channels, "outputstreams_channel_bytes_total", "counter", "Bytes published by the channel ID", ChannelLabel, []( Channel const & c_ ) { return c_.bytes; } );
+			WritePrometheusFamily< Channel >( out_, channels, "outputstreams_channel_lock_spins_total", "counter", "Failed attempts to take a shared stream's lock", ChannelLabel, []( Channel const & c_ ) { return c_.lockSpins; } );
+			WritePrometheusFamily< Channel >( out_, channels, "outputstreams_channel_lock_wait_nanoseconds_total", "counter", "Time spent retrying shared stream locks", ChannelLabel, []( Channel const & c_ ) { return c_.lockWaitNanoseconds; } );
+		}
+	}
+}
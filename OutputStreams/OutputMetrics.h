@@ -0,0 +1,152 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	OutputMetrics.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Runtime counters for OutputStreams and OutputChannels and a snapshot API that aggregates them
+///
+///				 A channel's counters have a single writer, the thread that owns the channel, so their increments are a relaxed load
+///				 and store with no locked instructions. A stream's counters may be written by several threads at once: a combining
+///				 thread, or single-thread channels on different threads writing without the stream's lock. Their increments are a
+///				 relaxed fetch_add. A snapshot taken from another thread is approximate but tear-free.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef OutputMetrics_DEFINED_19_10_2026
+#define OutputMetrics_DEFINED_19_10_2026
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace mbp
+{
+	namespace streams
+	{
+		// a counter with a single writer
+		class MetricCounter
+		{
+		public:
+			MetricCounter() : m_value( 0 ) {}
+			void Add( uint64_t count_ = 1 ) { m_value.store( m_value.load( std::memory_order_relaxed ) + count_, std::memory_order_relaxed ); }
+			void Set( uint64_t value_ ) { m_value.store( value_, std::memory_order_relaxed ); }
+			uint64_t Get() const { return m_value.load( std::memory_order_relaxed ); }
+		private:
+			std::atomic< uint64_t > m_value;
+		};
+
+		// a counter any number of threads may add to
+		class SharedMetricCounter
+		{
+		public:
+			SharedMetricCounter() : m_value( 0 ) {}
+			void Add( uint64_t count_ = 1 ) { m_value.fetch_add( count_, std::memory_order_relaxed ); }
+			void Set( uint64_t value_ ) { m_value.store( value_, std::memory_order_relaxed ); }
+			uint64_t Get() const { return m_value.load( std::memory_order_relaxed ); }
+		private:
+			std::atomic< uint64_t > m_value;
+		};
+
+		inline uint64_t GetMetricsClockNanoseconds()
+		{
+			return static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+		}
+
+		// counters kept by every BasicStream_t and written by its OutputBuffer_t
+		struct StreamMetrics
+		{
+			SharedMetricCounter linesEmitted;		// lines passed to the OutputTarget, a batch from a batching OutputChannel counting once
+			SharedMetricCounter linesFiltered;		// lines dropped by the stream's own enable and filter settings, or as repeats
+			SharedMetricCounter bytes;				// bytes passed to the OutputTarget
+			SharedMetricCounter flushNanoseconds;	// time spent inside the OutputTarget
+			SharedMetricCounter targetErrors;		// failures reported by the OutputTarget, where it reports them
+			std::string name;
+			// intrusive registration links, so registering never allocates
+			StreamMetrics * prev = nullptr;
+			StreamMetrics * next = nullptr;
+		};
+
+		// counters kept by every ChannelBuffer_t for the OutputChannel_t it serves. They are registered for the life of the buffer, and
+		// counted under channelId while the buffer is bound to a channel.
+		struct ChannelMetrics
+		{
+			std::atomic< int > channelId{ -1 };
+			std::atomic< bool > inUse{ false };
+			MetricCounter linesEmitted;		// lines published to the channel's streams
+			MetricCounter linesFiltered;	// lines dropped by the channel ID's settings or by every target stream's settings
+			MetricCounter bytes;			// bytes published, counted once per line regardless of the number of streams
+			MetricCounter lockSpins;		// failed attempts to take a shared stream's lock
+			MetricCounter lockWaitNanoseconds;	// time spent retrying those locks
+			ChannelMetrics * prev = nullptr;
+			ChannelMetrics * next = nullptr;
+		};
+
+		// the counts of a Channel ID's buffers once they are unbound, kept in the ID's registry entry and registered on the ID's first use
+		struct ChannelTotals
+		{
+			std::atomic< int > channelId{ -1 };
+			SharedMetricCounter linesEmitted;
+			SharedMetricCounter linesFiltered;
+			SharedMetricCounter bytes;
+			SharedMetricCounter lockSpins;
+			SharedMetricCounter lockWaitNanoseconds;
+			ChannelTotals * next = nullptr;
+		};
+
+		// registration, performed by OutputStream_t, ChannelBuffer_t and the channel registry. Registration is never on the output path.
+		void RegisterMetrics( StreamMetrics * metrics_ );
+		void UnregisterMetrics( StreamMetrics * metrics_ );
+		void RegisterMetrics( ChannelMetrics * metrics_ );
+		void UnregisterMetrics( ChannelMetrics * metrics_ );
+		void RegisterMetrics( ChannelTotals * totals_, int channelId_ );
+		// folds a buffer's counts into its Channel ID's totals and zeroes them, without locking, so the buffer can be bound to another channel
+		void RetireMetrics( ChannelMetrics & metrics_, ChannelTotals & totals_ );
+		// serialises registration and snapshots. Readers of the counters never take it.
+		extern std::mutex g_metricsMutex;
+
+		struct MetricsSnapshot
+		{
+			struct Stream
+			{
+				std::string name;
+				uint64_t linesEmitted;
+				uint64_t linesFiltered;
+				uint64_t bytes;
+				uint64_t flushNanoseconds;
+				uint64_t targetErrors;
+			};
+			// one entry per channel ID, summing live and destroyed channels using that ID
+			struct Channel
+			{
+				int channelId;
+				uint64_t liveChannels;
+				uint64_t linesEmitted;
+				uint64_t linesFiltered;
+				uint64_t bytes;
+				uint64_t lockSpins;
+				uint64_t lockWaitNanoseconds;
+			};
+			std::vector< Stream > streams;
+			std::vector< Channel > channels;
+		};
+
+		MetricsSnapshot GetMetricsSnapshot();
+
+		enum class MetricsFormat
+		{
+			Text,
+			Prometheus		// text exposition format
+		};
+
+		// writes a snapshot one line at a time, flushing each so it passes through OutputStreams and OutputChannels as separate lines
+		void WriteMetrics( std::ostream & out_, MetricsSnapshot const & snapshot_, MetricsFormat format_ = MetricsFormat::Text );
+	}
+}
+
+#endif // #ifndef OutputMetrics_DEFINED_19_10_2026
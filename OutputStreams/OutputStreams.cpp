@@ -33,6 +33,7 @@ namespace mbp
 
 		//////////////////////////////////////////////////////////////////////////
 		// Conversion functions called by ConvertingStream_t operator <<
+		// In repair mode malformed source sequences are replaced by U+FFFD and counted on the stream
 		//////////////////////////////////////////////////////////////////////////
 
 		// assume UTF32 text and transform into UTF8 
@@ -41,8 +42,14 @@ namespace mbp
 			char buf[ 4 ];
 			char32_t cp;
 			size_t count;
+			bool const repair = stream_.GetRepairUTF();
 			for( ; cp = *pSource_++; )
 			{
+				if ( repair && !strings::IsValidCodepoint( cp ) )
+				{
+					cp = strings::kReplacementCharacter;
+					stream_.CountRepair();
+				}
 				count = strings::NumUTF8CharsFromCodepoint( cp );
 				strings::GetUTF8FromCodePoint( cp, buf );
 				stream_.rdbuf()->sputn( buf, count );
@@ -56,8 +63,14 @@ namespace mbp
 			char16_t buf[ 2 ];
 			char32_t cp;
 			size_t count;
+			bool const repair = stream_.GetRepairUTF();
 			for ( ; cp = *pSource_++; )
 			{
+				if ( repair && !strings::IsValidCodepoint( cp ) )
+				{
+					cp = strings::kReplacementCharacter;
+					stream_.CountRepair();
+				}
 				count = strings::NumUTF16CharsFromCodepoint( cp );
 				strings::GetUTF16FromCodePoint( cp, buf );
 				stream_.rdbuf()->sputn( buf, count );
@@ -70,10 +83,14 @@ namespace mbp
 		{
 			char32_t cp;
 			char buf[ 4 ];
-			size_t count;	
+			size_t count;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while ( *pSource_ )
 			{
-				count = strings::GetCodepointAndBytesFromUTF16( pSource_, cp );
+				count = repair ? strings::GetValidCodepointAndBytesFromUTF16( pSource_, cp, valid ) : strings::GetCodepointAndBytesFromUTF16( pSource_, cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count >> 1;
 				count = strings::NumUTF8CharsFromCodepoint( cp );
 				strings::GetUTF8FromCodePoint( cp, buf );
@@ -87,9 +104,13 @@ namespace mbp
 		{
 			char32_t cp;
 			size_t count;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while ( *pSource_ )
 			{
-				count = strings::GetCodepointAndCountFromUTF8( pSource_, cp );
+				count = repair ? strings::GetValidCodepointAndCountFromUTF8( pSource_, cp, valid ) : strings::GetCodepointAndCountFromUTF8( pSource_, cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count;
 				stream_.rdbuf()->sputc( cp );
 			}
@@ -102,9 +123,13 @@ namespace mbp
 			char16_t buff[ 3 ];
 			char32_t cp;
 			size_t count, numChars;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while ( *pSource_ )
 			{
-				count = strings::GetCodepointAndCountFromUTF8( pSource_, cp );
+				count = repair ? strings::GetValidCodepointAndCountFromUTF8( pSource_, cp, valid ) : strings::GetCodepointAndCountFromUTF8( pSource_, cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count;
 				strings::GetUTF16FromCodePoint( cp, buff );
 				numChars = strings::NumUTF16CharsFromCodepoint( cp );
@@ -118,9 +143,13 @@ namespace mbp
 		{
 			char32_t cp;
 			size_t count;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while( *pSource_ )
 			{
-				count = strings::GetCodepointAndBytesFromUTF16( pSource_, cp );
+				count = repair ? strings::GetValidCodepointAndBytesFromUTF16( pSource_, cp, valid ) : strings::GetCodepointAndBytesFromUTF16( pSource_, cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count >> 1;
 				stream_.rdbuf()->sputc( cp );
 			}
@@ -137,9 +166,13 @@ namespace mbp
 		{
 			char32_t cp;
 			size_t count;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while ( *pSource_ )
 			{
-				count = strings::GetCodepointAndCountFromUTF8( pSource_, cp );
+				count = repair ? strings::GetValidCodepointAndCountFromUTF8( pSource_, cp, valid ) : strings::GetCodepointAndCountFromUTF8( pSource_, cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count;
 				stream_.rdbuf()->sputc( cp );
 			}
@@ -149,11 +182,14 @@ namespace mbp
 		ConvertingStream_t< wchar_t > & ConvertText( ConvertingStream_t< wchar_t > & stream_, char16_t const * pSource_ )
 		{
 			char32_t cp;
-			char16_t code;
 			size_t count;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while ( *pSource_ )
 			{
-				count = strings::GetCodepointAndBytesFromUTF16( pSource_, cp );
+				count = repair ? strings::GetValidCodepointAndBytesFromUTF16( pSource_, cp, valid ) : strings::GetCodepointAndBytesFromUTF16( pSource_, cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count >> 1;
 				stream_.rdbuf()->sputc( cp );
 			}
@@ -165,8 +201,14 @@ namespace mbp
 			char16_t buf[ 2 ];
 			char32_t cp;
 			size_t count;
+			bool const repair = stream_.GetRepairUTF();
 			for ( ; cp = *pSource_++; )
 			{
+				if ( repair && !strings::IsValidCodepoint( cp ) )
+				{
+					cp = strings::kReplacementCharacter;
+					stream_.CountRepair();
+				}
 				count = strings::NumUTF16CharsFromCodepoint( cp );
 				strings::GetUTF16FromCodePoint( cp, buf );
 				stream_.rdbuf()->sputn( buf, count );
@@ -179,8 +221,14 @@ namespace mbp
 			char buf[ 4 ];
 			char32_t cp;
 			size_t count;
+			bool const repair = stream_.GetRepairUTF();
 			for ( ; cp = *pSource_++; )
 			{
+				if ( repair && !strings::IsValidCodepoint( cp ) )
+				{
+					cp = strings::kReplacementCharacter;
+					stream_.CountRepair();
+				}
 				count = strings::NumUTF8CharsFromCodepoint( cp );
 				strings::GetUTF8FromCodePoint( cp, buf );
 				stream_.rdbuf()->sputn( buf, count );
@@ -194,9 +242,13 @@ namespace mbp
 			char16_t buff[ 3 ];
 			char32_t cp;
 			size_t count, numChars;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while ( *pSource_ )
 			{
-				count = strings::GetCodepointAndCountFromUTF8( pSource_, cp );
+				count = repair ? strings::GetValidCodepointAndCountFromUTF8( pSource_, cp, valid ) : strings::GetCodepointAndCountFromUTF8( pSource_, cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count;
 				strings::GetUTF16FromCodePoint( cp, buff );
 				numChars = strings::NumUTF16CharsFromCodepoint( cp );
@@ -210,8 +262,14 @@ namespace mbp
 			char16_t buf[ 2 ];
 			char32_t cp;
 			size_t count;
+			bool const repair = stream_.GetRepairUTF();
 			for ( ; cp = *pSource_++; )
 			{
+				if ( repair && !strings::IsValidCodepoint( cp ) )
+				{
+					cp = strings::kReplacementCharacter;
+					stream_.CountRepair();
+				}
 				count = strings::NumUTF16CharsFromCodepoint( cp );
 				strings::GetUTF16FromCodePoint( cp, buf );
 				stream_.rdbuf()->sputn( reinterpret_cast< wchar_t const * >( buf ), count );
@@ -224,9 +282,16 @@ namespace mbp
 			char32_t cp;
 			char buf[ 4 ];
 			size_t count;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while ( *pSource_ )
 			{
-				count = strings::GetCodepointAndBytesFromUTF16( reinterpret_cast< char16_t const * >( pSource_ ), cp );
+				if ( repair )
+					count = strings::GetValidCodepointAndBytesFromUTF16( reinterpret_cast< char16_t const * >( pSource_ ), cp, valid );
+				else
+					count = strings::GetCodepointAndBytesFromUTF16( reinterpret_cast< char16_t const * >( pSource_ ), cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count >> 1;
 				count = strings::NumUTF8CharsFromCodepoint( cp );
 				strings::GetUTF8FromCodePoint( cp, buf );
@@ -239,14 +304,124 @@ namespace mbp
 		{
 			char32_t cp;
 			size_t count;
+			bool valid = true;
+			bool const repair = stream_.GetRepairUTF();
 			while ( *pSource_ )
 			{
-				count = strings::GetCodepointAndBytesFromUTF16( reinterpret_cast< char16_t const * >( pSource_ ), cp );
+				if ( repair )
+					count = strings::GetValidCodepointAndBytesFromUTF16( reinterpret_cast< char16_t const * >( pSource_ ), cp, valid );
+				else
+					count = strings::GetCodepointAndBytesFromUTF16( reinterpret_cast< char16_t const * >( pSource_ ), cp );
+				if ( !valid )
+					stream_.CountRepair();
 				pSource_ += count >> 1;
 				stream_.rdbuf()->sputc( cp );
 			}
 			return stream_;
 		}
 #endif //#if defined( __linux )...
+
+		//////////////////////////////////////////////////////////////////////////
+		// Same encoding repair functions. Well formed runs are written in one sputn and only the malformed sequences between them are replaced
+		//////////////////////////////////////////////////////////////////////////
+
+		ConvertingStream_t< char > & RepairText( ConvertingStream_t< char > & stream_, char const * pSource_ )
+		{
+			char const * pRun = pSource_;
+			char32_t cp;
+			size_t count;
+			bool valid;
+			while ( *pSource_ )
+			{
+				// pass ASCII straight through
+				if ( !( *pSource_ & 0x80 ) )
+				{
+					++pSource_;
+					continue;
+				}
+				count = strings::GetValidCodepointAndCountFromUTF8( pSource_, cp, valid );
+				if ( !valid )
+				{
+					stream_.rdbuf()->sputn( pRun, pSource_ - pRun );
+					stream_.rdbuf()->sputn( strings::kReplacementUTF8, strings::kReplacementUTF8Length );
+					stream_.CountRepair();
+					pRun = pSource_ + count;
+				}
+				pSource_ += count;
+			}
+			stream_.rdbuf()->sputn( pRun, pSource_ - pRun );
+			return stream_;
+		}
+
+		ConvertingStream_t< char16_t > & RepairText( ConvertingStream_t< char16_t > & stream_, char16_t const * pSource_ )
+		{
+			char16_t const replacement = static_cast< char16_t >( strings::kReplacementCharacter );
+			char16_t const * pRun = pSource_;
+			char32_t cp;
+			size_t count;
+			bool valid;
+			while ( *pSource_ )
+			{
+				count = strings::GetValidCodepointAndBytesFromUTF16( pSource_, cp, valid ) >> 1;
+				if ( !valid )
+				{
+					stream_.rdbuf()->sputn( pRun, pSource_ - pRun );
+					stream_.rdbuf()->sputc( replacement );
+					stream_.CountRepair();
+					pRun = pSource_ + count;
+				}
+				pSource_ += count;
+			}
+			stream_.rdbuf()->sputn( pRun, pSource_ - pRun );
+			return stream_;
+		}
+
+		ConvertingStream_t< char32_t > & RepairText( ConvertingStream_t< char32_t > & stream_, char32_t const * pSource_ )
+		{
+			char32_t const * pRun = pSource_;
+			for ( ; *pSource_; ++pSource_ )
+			{
+				if ( !strings::IsValidCodepoint( *pSource_ ) )
+				{
+					stream_.rdbuf()->sputn( pRun, pSource_ - pRun );
+					stream_.rdbuf()->sputc( strings::kReplacementCharacter );
+					stream_.CountRepair();
+					pRun = pSource_ + 1;
+				}
+			}
+			stream_.rdbuf()->sputn( pRun, pSource_ - pRun );
+			return stream_;
+		}
+
+		ConvertingStream_t< wchar_t > & RepairText( ConvertingStream_t< wchar_t > & stream_, wchar_t const * pSource_ )
+		{
+			wchar_t const replacement = static_cast< wchar_t >( strings::kReplacementCharacter );
+			wchar_t const * pRun = pSource_;
+			char32_t cp;
+			size_t count;
+			bool valid;
+			while ( *pSource_ )
+			{
+#if defined( _MSC_VER )
+				// UTF16 wchar_t
+				count = strings::GetValidCodepointAndBytesFromUTF16( reinterpret_cast< char16_t const * >( pSource_ ), cp, valid ) >> 1;
+#else
+				// UTF32 wchar_t
+				cp = static_cast< char32_t >( *pSource_ );
+				valid = strings::IsValidCodepoint( cp );
+				count = 1;
+#endif // #if defined( _MSC_VER )
+				if ( !valid )
+				{
+					stream_.rdbuf()->sputn( pRun, pSource_ - pRun );
+					stream_.rdbuf()->sputc( replacement );
+					stream_.CountRepair();
+					pRun = pSource_ + count;
+				}
+				pSource_ += count;
+			}
+			stream_.rdbuf()->sputn( pRun, pSource_ - pRun );
+			return stream_;
+		}
 	}
 }
@@ -14,11 +14,13 @@
 #ifndef OutputStreams_DEFINED_31_12_2014
 #define OutputStreams_DEFINED_31_12_2014
 
+#include <algorithm>
 #include <mutex>
 #include <iostream>
 #include <sstream>
 #include <atomic>
 #include <iomanip>
+#include <memory>
 #if defined( __linux )
 #include <cstring>
 #endif
@@ -26,6 +28,8 @@
 
 #include "OutputTargets.h"
 #include "OutputStamp.h"
+#include "OutputMetrics.h"
+#include "LineDeduplicator.h"
 #include "Utilities/Strings.h"
 
 namespace mbp
@@ -51,7 +55,7 @@ namespace mbp
 
 		struct StreamSettings
 		{
-			StreamSettings( SettingsType enable_ = 1, SettingsType initPriority_ = kPriorityDefault, SettingsType initialFilter_ = kDefaultFilter )
+			constexpr StreamSettings( SettingsType enable_ = 1, SettingsType initPriority_ = kPriorityDefault, SettingsType initialFilter_ = kDefaultFilter )
 				: enabled( enable_ ), currentPriority( initPriority_ ), defaultPriority( initPriority_ ), filter( initialFilter_ )
 			{}
 
@@ -72,6 +76,13 @@ namespace mbp
 			SettingsType GetFilter() { return filter.load( std::memory_order_relaxed ); }
 
 			void ResetDefault() { currentPriority.store( defaultPriority, std::memory_order_relaxed ); }
+			void CopyFrom( StreamSettings & other_ )
+			{
+				Enable( other_.GetEnable() );
+				SetPriority( other_.GetPriority() );
+				SetDefaultPriority( other_.GetDefaultPriority() );
+				SetFilter( other_.GetFilter() );
+			}
 			bool CanBeOutput() {
 				bool ok = enabled.load( std::memory_order_relaxed ) && ( currentPriority.load( std::memory_order_relaxed ) <= filter.load( std::memory_order_relaxed ) );
 				return ok;
@@ -81,18 +92,36 @@ namespace mbp
 		// The default StreamSettings instance
 		extern StreamSettings & GetDefaultChannelSettings();
 
-		// flags cleared by the OutputStream destructor
-		extern void * g_allSharedStreams[];
-		extern uint8_t g_streamInitFlags[];
-		// mutex protecting the above
-		extern std::mutex g_streamsMutex;
-		// hash and probe function
-		extern size_t GetIndexFromPointer( void * ptr_ );
+		// the registry index of a stream with no OutputChannels attached
+		size_t constexpr kInvalidRegistryIndex = ~static_cast< size_t >( 0 );
+		// called by the OutputStream destructor so attached OutputChannels skip the stream from then on
+		extern void DetachSharedStream( void * stream_, size_t registryIndex_ );
+		// Links an OutputStream's settings to their slot in the shared memory control block. Every OutputStream's is listed while it exists,
+		// so opening a block moves the settings of streams that already exist and closing it moves them back. See ControlBlock.h.
+		struct StreamSettingsMirror
+		{
+			StreamSettings * own = nullptr;
+			std::string const * name = nullptr;
+			std::atomic< StreamSettings * > shared{ nullptr };
+			StreamSettingsMirror * prev = nullptr;
+			StreamSettingsMirror * next = nullptr;
+		};
+		// lists a stream's settings, moving them into the control block if one is open and has room, and removes them again
+		extern void AttachStreamSettings( StreamSettingsMirror & mirror_ );
+		extern void DetachStreamSettings( StreamSettingsMirror & mirror_ );
 
 		//////////////////////////////////////////////////////////////////////////
 		/// BasicStream
 		//////////////////////////////////////////////////////////////////////////
 
+		// each thread starts its search for a free combining slot at a different place so, up to the slot count, producers keep their own slot
+		inline size_t GetCombiningSlotHint()
+		{
+			static std::atomic< size_t > nextHint( 0 );
+			thread_local size_t const hint = nextHint.fetch_add( 1, std::memory_order_relaxed );
+			return hint;
+		}
+
 		template < typename ELEM_ >
 		class BasicStream_t : public std::basic_ostream< ELEM_, std::char_traits< ELEM_ > >
 		{
@@ -102,22 +131,27 @@ namespace mbp
 				: std::basic_ostream< ELEM_, traits >( buffer_ )
 				, m_stamp( stamp_ )
 				, m_isChannelTarget( false )
+				, m_registryIndex( kInvalidRegistryIndex )
+				, m_linePriority( kNoLinePriority )
 			{
-				m_settings.Enable( initSettings_->GetEnable() );
-				m_settings.SetPriority( initSettings_->GetPriority() );
-				m_settings.SetDefaultPriority( initSettings_->GetDefaultPriority() );
-				m_settings.SetFilter( initSettings_->GetFilter() );
+				m_settings.CopyFrom( *initSettings_ );
 			}
 			virtual ~BasicStream_t() {}
 
-			virtual void Enable( SettingsType enable_ ) { m_settings.Enable( enable_ ); }
-			virtual void SetPriority( SettingsType newPriority_ ) { m_settings.SetPriority( newPriority_ ); }
-			virtual void SetDefaultPriority( SettingsType newDefault_ ) { m_settings.SetDefaultPriority( newDefault_ ); }
-			virtual void SetFilter( SettingsType newCap_ ) { m_settings.SetFilter( newCap_ ); }
-			virtual SettingsType GetEnable() { return m_settings.GetEnable(); }
-			virtual SettingsType GetPriority() { return m_settings.GetPriority(); }
-			virtual SettingsType GetDefaultPriority() { return m_settings.GetDefaultPriority(); }
-			virtual SettingsType GetFilter() { return m_settings.GetFilter(); }
+			virtual void Enable( SettingsType enable_ ) { GetSettings().Enable( enable_ ); }
+			virtual void SetPriority( SettingsType newPriority_ ) { GetSettings().SetPriority( newPriority_ ); }
+			virtual void SetDefaultPriority( SettingsType newDefault_ ) { GetSettings().SetDefaultPriority( newDefault_ ); }
+			virtual void SetFilter( SettingsType newCap_ ) { GetSettings().SetFilter( newCap_ ); }
+			virtual SettingsType GetEnable() { return GetSettings().GetEnable(); }
+			virtual SettingsType GetPriority() { return GetSettings().GetPriority(); }
+			virtual SettingsType GetDefaultPriority() { return GetSettings().GetDefaultPriority(); }
+			virtual SettingsType GetFilter() { return GetSettings().GetFilter(); }
+			// the settings in use: the stream's own, or its slot in the shared memory control block while one is open
+			StreamSettings & GetSettings()
+			{
+				StreamSettings * shared = m_mirror.shared.load( std::memory_order_acquire );
+				return shared ? *shared : m_settings;
+			}
 
 			// access functions when the stream is a shared target
 			void Lock() { m_lock.lock(); }
@@ -125,14 +159,107 @@ namespace mbp
 			bool TryLock() { return m_lock.try_lock(); }
 			void SetIsChannelTarget( bool isShared_ ) { m_isChannelTarget.store( isShared_, std::memory_order_release ); }
 			bool GetIsChannelTarget() { return m_isChannelTarget.load( std::memory_order_acquire ); }
+			// the stream's slot in the shared stream registry while OutputChannels are attached, only changed under g_streamsMutex
+			size_t GetRegistryIndex() const { return m_registryIndex.load( std::memory_order_relaxed ); }
+			void SetRegistryIndex( size_t index_ ) { m_registryIndex.store( index_, std::memory_order_relaxed ); }
+			// the priority a channel published the lines about to be flushed at, passed to the target's Commit() for that flush. Set by the
+			// stream's writer, holding its lock if it is shared.
+			void SetLinePriority( int priority_ ) { m_linePriority = priority_; }
+			int GetLinePriority() const { return m_linePriority; }
 
 			OutputStamp& GetOutputStamp() { return m_stamp; }
+			StreamMetrics & GetMetrics() { return m_metrics; }
+
+			// Flat combining for a stream shared by many multithread OutputChannels. A producer posts its line to a slot and whichever producer
+			// next takes the stream's lock passes every posted line to the target together, see WriteLines(). Producers that miss the
+			// lock wait for their slot to be drained instead of queueing on it. Enable combining before attaching channels to the stream.
+			static size_t constexpr kNumCombiningSlots = 64;
+			struct alignas( 64 ) CombiningSlot
+			{
+				enum : uint32_t { kFree, kClaimed, kPosted, kDone };
+				std::atomic< uint32_t > state{ kFree };
+				ELEM_ const * line = nullptr;
+				size_t length = 0;
+				int priority = kNoLinePriority;
+			};
+			void SetCombining( bool combining_ ) { m_combiningSlots.reset( combining_ ? new CombiningSlot[ kNumCombiningSlots ] : nullptr ); }
+			bool IsCombining() const { return nullptr != m_combiningSlots; }
+			// posts a line, which must stay valid until TryCombine() succeeds. Returns nullptr if every slot is in use.
+			CombiningSlot * PostCombined( ELEM_ const * line_, size_t length_, int priority_ = kNoLinePriority )
+			{
+				size_t hint = GetCombiningSlotHint();
+				for ( size_t i = 0; i < kNumCombiningSlots; ++i )
+				{
+					CombiningSlot & slot = m_combiningSlots[ ( hint + i ) % kNumCombiningSlots ];
+					uint32_t expected = CombiningSlot::kFree;
+					if ( slot.state.load( std::memory_order_relaxed ) == expected && slot.state.compare_exchange_strong( expected, CombiningSlot::kClaimed, std::memory_order_acquire ) )
+					{
+						slot.line = line_;
+						slot.length = length_;
+						slot.priority = priority_;
+						slot.state.store( CombiningSlot::kPosted, std::memory_order_release );
+						return &slot;
+					}
+				}
+				return nullptr;
+			}
+			// returns true, and frees the slot, once its line has been written: by another producer or by this one taking the combiner role. Never blocks.
+			bool TryCombine( CombiningSlot * slot_ )
+			{
+				if ( slot_->state.load( std::memory_order_acquire ) != CombiningSlot::kDone )
+				{
+					if ( !TryLock() )
+						return false;
+					// the previous combiner may have drained the slot between the check and the lock
+					if ( slot_->state.load( std::memory_order_acquire ) != CombiningSlot::kDone )
+					{
+						CombiningSlot * drained[ kNumCombiningSlots ];
+						OutputSegment_t< ELEM_ > lines[ kNumCombiningSlots ];
+						size_t numDrained = 0;
+						for ( size_t i = 0; i < kNumCombiningSlots; ++i )
+						{
+							CombiningSlot & slot = m_combiningSlots[ i ];
+							if ( slot.state.load( std::memory_order_acquire ) == CombiningSlot::kPosted )
+							{
+								lines[ numDrained ] = OutputSegment_t< ELEM_ >{ slot.line, static_cast< uint32_t >( slot.length ), static_cast< uint32_t >( slot.length * sizeof( ELEM_ ) ), slot.priority };
+								drained[ numDrained++ ] = &slot;
+							}
+						}
+						WriteLines( lines, numDrained );
+						// producers may reuse their lines as soon as they see their slot done
+						for ( size_t i = 0; i < numDrained; ++i )
+							drained[ i ]->state.store( CombiningSlot::kDone, std::memory_order_release );
+					}
+					Unlock();
+				}
+				slot_->state.store( CombiningSlot::kFree, std::memory_order_release );
+				return true;
+			}
+			// writes complete lines for the combiner, caller holds the stream's lock. By default they are joined in the stream's buffer and flushed
+			// as one Output(), OutputStreams whose target has OutputV() pass them on without copying.
+			virtual void WriteLines( OutputSegment_t< ELEM_ > const * lines_, size_t numLines_ )
+			{
+				int priority = kNoLinePriority;
+				for ( size_t i = 0; i < numLines_; ++i )
+				{
+					this->write( lines_[ i ].data, lines_[ i ].numCharacters );
+					priority = std::min( priority, lines_[ i ].priority );
+				}
+				SetLinePriority( priority );
+				this->flush();
+			}
 			
+			// the stream's own settings, see GetSettings()
 			StreamSettings m_settings;
+			StreamMetrics m_metrics;
 		protected:
+			StreamSettingsMirror m_mirror;
+			std::unique_ptr< CombiningSlot[] > m_combiningSlots;
 			std::mutex m_lock;
 			OutputStamp & m_stamp;
 			std::atomic< bool > m_isChannelTarget;
+			std::atomic< size_t > m_registryIndex;
+			int m_linePriority;
 			BasicStream_t() = delete;
 			BasicStream_t( BasicStream_t const & other_ ) = delete;
 			BasicStream_t operator=( BasicStream_t const & other_ ) = delete;
@@ -162,8 +289,20 @@ namespace mbp
 			using traits = std::char_traits< ELEM_ >;
 			ConvertingStream_t( std::basic_stringbuf< ELEM_, traits, std::allocator< ELEM_ > > * buffer_, StreamSettings * initSettings_, OutputStamp & stamp_ )
 				: BasicStream_t< ELEM_ >( buffer_, initSettings_, stamp_ )
+				, m_repairUTF( false )
+				, m_repairCount( 0 )
 			{}
 			virtual ~ConvertingStream_t() {}
+
+			// repair mode substitutes U+FFFD for malformed input sequences as they are converted, counting each substitution
+			void SetRepairUTF( bool repair_ ) { m_repairUTF.store( repair_, std::memory_order_relaxed ); }
+			bool GetRepairUTF() const { return m_repairUTF.load( std::memory_order_relaxed ); }
+			uint64_t GetRepairCount() const { return m_repairCount.load( std::memory_order_relaxed ); }
+			void ResetRepairCount() { m_repairCount.store( 0, std::memory_order_relaxed ); }
+			void CountRepair() { m_repairCount.fetch_add( 1, std::memory_order_relaxed ); }
+		private:
+			std::atomic< bool > m_repairUTF;
+			std::atomic< uint64_t > m_repairCount;
 		};
 
 		//////////////////////////////////////////////////////////////////////////
@@ -218,41 +357,125 @@ namespace mbp
 			{}
 			virtual ~OutputBuffer_t() = default;
 			TARGET_< ELEM_ > & GetOutputTarget() { return m_outputTarget; }
+			// collapses runs of identical lines written directly to the stream. Lines from OutputChannels are deduplicated by the channels.
+			void SetDeduplication( std::chrono::milliseconds window_ )
+			{
+				FlushRepeats();
+				m_dedup.SetWindow( window_ );
+			}
+			// reports a run of repeats still in progress
+			void FlushRepeats()
+			{
+				if ( uint64_t repeats = m_dedup.TakeRepeats() )
+					OutputRepeats( repeats );
+			}
+			// complete lines from the stream's combiner, already stamped by their channels, passed to a target with OutputV() in one call
+			void OutputLines( OutputSegment_t< ELEM_ > const * lines_, size_t numLines_ )
+			{
+				if ( m_stream.GetSettings().CanBeOutput() )
+				{
+					uint64_t numBytes = 0;
+					int priority = m_stream.GetSettings().GetPriority();
+					for ( size_t i = 0; i < numLines_; ++i )
+					{
+						numBytes += lines_[ i ].numBytes;
+						priority = std::min( priority, lines_[ i ].priority );
+					}
+					auto flushStart = GetMetricsClockNanoseconds();
+					m_outputTarget.OutputV( lines_, numLines_ );
+					m_stream.m_metrics.flushNanoseconds.Add( GetMetricsClockNanoseconds() - flushStart );
+					m_stream.m_metrics.linesEmitted.Add( numLines_ );
+					m_stream.m_metrics.bytes.Add( numBytes );
+					Commit( priority );
+				}
+				else
+					m_stream.m_metrics.linesFiltered.Add( numLines_ );
+				m_stream.GetSettings().SetPriority( m_stream.GetSettings().GetDefaultPriority() );
+			}
 		protected:
 			virtual int sync() override
 			{
-				int maxLength = 0;
 				uint32_t numCharacters = static_cast< uint32_t >( base::pptr() - base::pbase() );
-				if ( m_stream.m_settings.CanBeOutput() )
+				auto isTarget = m_stream.GetIsChannelTarget();
+				// channel targets receive lines already stamped by their channels
+				int maxLength = isTarget ? 0 : m_stream.GetOutputStamp().GetMaxLength();
+				if ( m_stream.GetSettings().CanBeOutput() && !IsRepeat( isTarget, maxLength, numCharacters ) )
 				{
-					int stampLength = 0;
-					int offset = 0;
-					auto isTarget = m_stream.GetIsChannelTarget();
-					if ( !isTarget )
-					{
-						maxLength = m_stream.GetOutputStamp().GetMaxLength();
-						stampLength = m_stream.GetOutputStamp().GetLength();
-						offset = maxLength - stampLength;
-						m_stream.GetOutputStamp().WriteStamp( base::pbase() + offset );
-					}
-						
-					// get the number of bytes to pass to the OutputTarget - useful for direct writes using system functions
-					uint32_t numBytes = ( numCharacters - offset ) * sizeof( ELEM_ );
+					int offset = isTarget ? 0 : WriteStamp( base::pbase(), maxLength );
 					// add a terminating zero character - OutputDebugString requires zero terminated strings, as might other OutputTarget implementations
 					base::sputc( 0 );
-					m_outputTarget.Output( base::pbase() + offset, numCharacters++ - offset, numBytes );
+					OutputLine( base::pbase() + offset, numCharacters++ - offset );
 				}
+				else
+					m_stream.m_metrics.linesFiltered.Add();
 				base::pbump( -static_cast< int >( numCharacters - maxLength ) );
 				// we reset priority level to default priority following each flush
-				m_stream.m_settings.SetPriority( m_stream.m_settings.GetDefaultPriority() );
+				m_stream.GetSettings().SetPriority( m_stream.GetSettings().GetDefaultPriority() );
+				m_stream.SetLinePriority( kNoLinePriority );
 				return 0;
 			}
+			// writes the stream's stamp to end where the maxLength_ characters reserved_ for it end, returning the offset the stamped line starts at
+			int WriteStamp( ELEM_ * reserved_, int maxLength_ )
+			{
+				OutputStamp & stamp = m_stream.GetOutputStamp();
+				int offset = maxLength_ - stamp.GetLength();
+				stamp.WriteStamp( reserved_ + offset );
+				return offset;
+			}
+			// passes a stamped, zero terminated line to the target, counting and committing it
+			void OutputLine( ELEM_ const * line_, uint32_t numCharacters_ )
+			{
+				// get the number of bytes to pass to the OutputTarget - useful for direct writes using system functions
+				uint32_t numBytes = numCharacters_ * sizeof( ELEM_ );
+				auto flushStart = GetMetricsClockNanoseconds();
+				m_outputTarget.Output( line_, numCharacters_, numBytes );
+				m_stream.m_metrics.flushNanoseconds.Add( GetMetricsClockNanoseconds() - flushStart );
+				m_stream.m_metrics.linesEmitted.Add();
+				m_stream.m_metrics.bytes.Add( numBytes );
+				Commit( std::min< int >( m_stream.GetSettings().GetPriority(), m_stream.GetLinePriority() ) );
+			}
+			// Lets the target act on the priority of what it has just been given, a durable file syncing before the writer continues. Lines from
+			// OutputChannels are committed at the highest of the stream's priority and the priorities they were published at.
+			void Commit( int priority_ )
+			{
+				if constexpr ( HasCommit< TARGET_< ELEM_ > >::value )
+				{
+					auto flushStart = GetMetricsClockNanoseconds();
+					m_outputTarget.Commit( priority_ );
+					m_stream.m_metrics.flushNanoseconds.Add( GetMetricsClockNanoseconds() - flushStart );
+				}
+				if constexpr ( HasErrorCount< TARGET_< ELEM_ > >::value )
+					m_stream.m_metrics.targetErrors.Set( m_outputTarget.GetErrorCount() );
+			}
+			// true if the line repeats the previous one and is dropped. A line ending a run of repeats reports the run first.
+			bool IsRepeat( bool isTarget_, int maxLength_, uint32_t numCharacters_ )
+			{
+				if ( isTarget_ || !m_dedup.IsEnabled() )
+					return false;
+				uint64_t repeats = 0;
+				if ( m_dedup.IsRepeat( base::pbase() + maxLength_, ( numCharacters_ - maxLength_ ) * sizeof( ELEM_ ), GetMetricsClockNanoseconds(), repeats ) )
+					return true;
+				if ( repeats )
+					OutputRepeats( repeats );
+				return false;
+			}
+			// the report is stamped and output like any line written to the stream, in its own buffer as the stream's holds the current line
+			void OutputRepeats( uint64_t repeats_ )
+			{
+				int maxLength = m_stream.GetIsChannelTarget() ? 0 : m_stream.GetOutputStamp().GetMaxLength();
+				m_repeatLine.assign( static_cast< size_t >( maxLength ), static_cast< ELEM_ >( 'R' ) );
+				m_repeatLine += LineDeduplicator::FormatRepeats< ELEM_ >( repeats_ );
+				int offset = maxLength ? WriteStamp( &m_repeatLine[ 0 ], maxLength ) : 0;
+				OutputLine( m_repeatLine.c_str() + offset, static_cast< uint32_t >( m_repeatLine.size() - offset ) );
+			}
 		private:
 			OutputBuffer_t() = delete;
 			OutputBuffer_t( OutputBuffer_t const & rhs_ ) = delete;
 			OutputBuffer_t & operator = ( OutputBuffer_t const & rhs_ ) = delete;
 			BasicStream_t< ELEM_ > & m_stream;
 			TARGET_< ELEM_ > m_outputTarget;
+			LineDeduplicator m_dedup;
+			std::basic_string< ELEM_ > m_repeatLine;
 		};
 
 		//////////////////////////////////////////////////////////////////////////
@@ -267,21 +490,39 @@ namespace mbp
 			OutputStream_t( char const * const initString_ = nullptr, OutputStamp & stamp_ = OutputStamp::GetDummyStamp(), StreamSettings * initialSettings_ = &GetDefaultChannelSettings() )
 				: STREAMBASE_< ELEM_ >( &m_buffer, initialSettings_, stamp_ )
 				, m_buffer( *this, initString_ )
-			{}
+			{
+				// a stream without a name takes its target's default name, or is given a generated one, so its settings can be found by name
+				if ( initString_ )
+					this->m_metrics.name = initString_;
+				else if constexpr ( HasDefaultName< TARGET_< ELEM_ > >::value )
+					this->m_metrics.name = TARGET_< ELEM_ >::GetDefaultName();
+				RegisterMetrics( &this->m_metrics );
+				this->m_mirror.own = &this->m_settings;
+				this->m_mirror.name = &this->m_metrics.name;
+				AttachStreamSettings( this->m_mirror );
+			}
 			virtual ~OutputStream_t()
 			{
+				m_buffer.FlushRepeats();
+				DetachStreamSettings( this->m_mirror );
+				UnregisterMetrics( &this->m_metrics );
+				// ensure OutputChannels know we have been destroyed
 				if ( STREAMBASE_< ELEM_ >::GetIsChannelTarget() )
-				{
-					// ensure OutputChannels know we have been destroyed
-					size_t index = GetIndexFromPointer( this );
-					g_streamsMutex.lock();
-					g_streamInitFlags[ index ] = 0;
-					g_allSharedStreams[ index ] = nullptr;
-					g_streamsMutex.unlock();
-				}
+					DetachSharedStream( this, STREAMBASE_< ELEM_ >::GetRegistryIndex() );
 			}
 			TARGET_< ELEM_ > & GetOutputTarget() { return m_buffer.GetOutputTarget(); }
+			// a zero window disables deduplication
+			void SetDeduplication( std::chrono::milliseconds window_ ) { m_buffer.SetDeduplication( window_ ); }
+			// reports a run of repeats still in progress now, rather than when the run ends. Call it from the thread writing to the stream.
+			void FlushRepeats() { m_buffer.FlushRepeats(); }
 		protected:
+			virtual void WriteLines( OutputSegment_t< ELEM_ > const * lines_, size_t numLines_ ) override
+			{
+				if constexpr ( HasOutputV< TARGET_< ELEM_ >, ELEM_ >::value )
+					m_buffer.OutputLines( lines_, numLines_ );
+				else
+					STREAMBASE_< ELEM_ >::WriteLines( lines_, numLines_ );
+			}
 			OutputBuffer_t< ELEM_, TARGET_ > m_buffer;
 			OutputStream_t( OutputStream_t const & other_ ) = delete;
 			OutputStream_t operator=( OutputStream_t const & other_ ) = delete;
@@ -411,6 +652,20 @@ namespace mbp
 			int payload_;
 		};
 
+		struct RepairUTF
+		{
+			explicit RepairUTF( int val_ )
+				: payload_( val_ )
+			{}
+			template< typename T_ >
+			T_ & operator()( T_ && strm_ )
+			{
+				strm_.SetRepairUTF( payload_ != 0 );
+				return strm_;
+			}
+			int payload_;
+		};
+
 		// and their stream forwarders
 
 		template< typename ELEM_ >
@@ -433,6 +688,11 @@ namespace mbp
 		{
 			return obj_( stream_ );
 		}
+		template< typename ELEM_ >
+		ConvertingStream_t< ELEM_ > & operator << ( ConvertingStream_t< ELEM_ > & stream_, RepairUTF && obj_ )
+		{
+			return obj_( stream_ );
+		}
 
 		//////////////////////////////////////////////////////////////////////////
 		/// Stream and Channel string pointer handler for non-converting streams performs integral narrowing/widening
@@ -489,6 +749,16 @@ namespace mbp
 		ConvertingStream_t< char32_t > & ConvertText( ConvertingStream_t< char32_t > & stream_, wchar_t const * pSource_ );
 #endif //#if defined( __linux )...
 
+		//////////////////////////////////////////////////////////////////////////
+		/// Repair functions for ConvertingStream_t< ELEM_ > in repair mode when the source and stream encodings match
+		/// Well formed runs are written directly and malformed sequences replaced by U+FFFD
+		//////////////////////////////////////////////////////////////////////////
+
+		ConvertingStream_t< char > & RepairText( ConvertingStream_t< char > & stream_, char const * pSource_ );
+		ConvertingStream_t< char16_t > & RepairText( ConvertingStream_t< char16_t > & stream_, char16_t const * pSource_ );
+		ConvertingStream_t< char32_t > & RepairText( ConvertingStream_t< char32_t > & stream_, char32_t const * pSource_ );
+		ConvertingStream_t< wchar_t > & RepairText( ConvertingStream_t< wchar_t > & stream_, wchar_t const * pSource_ );
+
 		//////////////////////////////////////////////////////////////////////////
 		/// Operator << string pointer specialisations for Stream_t< ELEM_ >
 		/// These forward to the single integral string conversion function so we don't have to display a meaningless pointer value, or perform a direct write where the types are the same
@@ -576,18 +846,24 @@ namespace mbp
 
 		inline ConvertingStream_t< char > & operator << ( ConvertingStream_t< char > & stream_, char const * pSource_ )
 		{
+			if ( stream_.GetRepairUTF() )
+				return RepairText( stream_, pSource_ );
 			stream_.write( pSource_, strlen( pSource_ ) );
 			return stream_;
 		}
 
 		inline ConvertingStream_t< wchar_t > & operator << ( ConvertingStream_t< wchar_t > & stream_, wchar_t const * pSource_ )
 		{
+			if ( stream_.GetRepairUTF() )
+				return RepairText( stream_, pSource_ );
 			stream_.write( pSource_, wcslen( pSource_ ) );
 			return stream_;
 		}
 
 		inline ConvertingStream_t< char16_t > & operator << ( ConvertingStream_t< char16_t > & stream_, char16_t const * pSource_ )
 		{
+			if ( stream_.GetRepairUTF() )
+				return RepairText( stream_, pSource_ );
 			auto numChars = strings::GetUTF16StringLengthInCharacters( pSource_ );
 			stream_.rdbuf()->sputn( pSource_, numChars );
 			return stream_;
@@ -595,6 +871,8 @@ namespace mbp
 
 		inline ConvertingStream_t< char32_t > & operator << ( ConvertingStream_t< char32_t > & stream_, char32_t const * pSource_ )
 		{
+			if ( stream_.GetRepairUTF() )
+				return RepairText( stream_, pSource_ );
 			stream_.write( pSource_, strings::GetUTF32StringLengthInCharacters( pSource_ ) );
 			return stream_;
 		}
@@ -602,22 +880,30 @@ namespace mbp
 #if defined( _MSC_VER )
 		inline ConvertingStream_t< wchar_t > & operator << ( ConvertingStream_t< wchar_t > & stream_, char16_t const * pSource_ )
 		{
+			if ( stream_.GetRepairUTF() )
+				return RepairText( stream_, reinterpret_cast< wchar_t const * >( pSource_ ) );
 			stream_.write( reinterpret_cast< wchar_t const * >( pSource_ ), wcslen( reinterpret_cast< wchar_t const * >( pSource_ ) ) );
 			return stream_;
 		}
 		inline ConvertingStream_t< char16_t > & operator << ( ConvertingStream_t< char16_t > & stream_, wchar_t const * pSource_ )
 		{
+			if ( stream_.GetRepairUTF() )
+				return RepairText( stream_, reinterpret_cast< char16_t const * >( pSource_ ) );
 			stream_.write( reinterpret_cast< char16_t const * >( pSource_ ), wcslen( pSource_ ) );
 			return stream_;
 		}
 #elif defined( __linux )
 		inline ConvertingStream_t< wchar_t > & operator << ( ConvertingStream_t< wchar_t > & stream_, char32_t const * pSource_ )
 		{
+			if ( stream_.GetRepairUTF() )
+				return RepairText( stream_, reinterpret_cast< wchar_t const * >( pSource_ ) );
 			stream_.write( reinterpret_cast< wchar_t const * >( pSource_ ), wcslen( reinterpret_cast< wchar_t const * >( pSource_ ) ) );
 			return stream_;
 		}
 		inline ConvertingStream_t< char32_t > & operator << ( ConvertingStream_t< char32_t > & stream_, wchar_t const * pSource_ )
 		{
+			if ( stream_.GetRepairUTF() )
+				return RepairText( stream_, reinterpret_cast< char32_t const * >( pSource_ ) );
 			stream_.write( reinterpret_cast< char32_t const * >( pSource_ ), wcslen( pSource_ ) );
 			return stream_;
 		}
@@ -17,17 +17,107 @@
 #elif defined (__linux)
 #include "fcntl.h"
 #include "unistd.h"
+#include <climits>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #endif	// #if defined ( _MSC_VER )
 
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "assert.h"
+#include "Utilities/Strings.h"
+#include "FlightRecorder.h"
+#include "GroupCommit.h"
+#include "UringWriter.h"
 
 namespace mbp
 {
 	namespace streams
 	{
+		// OutputTargets may optionally report failures with uint64_t GetErrorCount() const, which OutputBuffers then publish in their stream's metrics
+		template< typename TARGET_, typename = void >
+		struct HasErrorCount : std::false_type {};
+		template< typename TARGET_ >
+		struct HasErrorCount< TARGET_, std::void_t< decltype( std::declval< TARGET_ const & >().GetErrorCount() ) > > : std::true_type {};
+
+		// OutputTargets may optionally take several complete lines at once with void OutputV( OutputSegment_t< ELEM_ > const *, size_t ), passing
+		// them to the system in one call. Segments are not zero terminated. For targets without OutputV, streams join the lines into one Output().
+		// Lines published by an OutputChannel carry the channel's priority, lines without one are committed at the stream's own.
+		constexpr int kNoLinePriority = std::numeric_limits< int >::max();
+		template< typename ELEM_ >
+		struct OutputSegment_t
+		{
+			ELEM_ const * data;
+			uint32_t numCharacters;
+			uint32_t numBytes;
+			int priority = kNoLinePriority;
+		};
+		template< typename TARGET_, typename ELEM_, typename = void >
+		struct HasOutputV : std::false_type {};
+		template< typename TARGET_, typename ELEM_ >
+		struct HasOutputV< TARGET_, ELEM_, std::void_t< decltype( std::declval< TARGET_ & >().OutputV( std::declval< OutputSegment_t< ELEM_ > const * >(), size_t( 0 ) ) ) > > : std::true_type {};
+
+		// OutputTargets may optionally be told each line's priority once it has been output, with void Commit( int priority ), to act on it before
+		// the writer continues
+		template< typename TARGET_, typename = void >
+		struct HasCommit : std::false_type {};
+		template< typename TARGET_ >
+		struct HasCommit< TARGET_, std::void_t< decltype( std::declval< TARGET_ & >().Commit( 0 ) ) > > : std::true_type {};
+
+		// OutputTargets may optionally name the streams using them that aren't given a name, with static char const * GetDefaultName()
+		template< typename TARGET_, typename = void >
+		struct HasDefaultName : std::false_type {};
+		template< typename TARGET_ >
+		struct HasDefaultName< TARGET_, std::void_t< decltype( TARGET_::GetDefaultName() ) > > : std::true_type {};
+
+#if defined ( __linux )
+		// writes every segment, IOV_MAX at a time, resuming after short writes. iov_ is modified.
+		inline bool WriteVectored( int desc_, iovec * iov_, size_t count_ )
+		{
+			while ( count_ )
+			{
+				ssize_t written = writev( desc_, iov_, static_cast< int >( count_ < IOV_MAX ? count_ : IOV_MAX ) );
+				if ( written < 0 )
+				{
+					if ( EINTR == errno )
+						continue;
+					return false;
+				}
+				for ( ; count_ && static_cast< size_t >( written ) >= iov_->iov_len; --count_, ++iov_ )
+					written -= static_cast< ssize_t >( iov_->iov_len );
+				if ( count_ )
+				{
+					iov_->iov_base = static_cast< char * >( iov_->iov_base ) + written;
+					iov_->iov_len -= static_cast< size_t >( written );
+				}
+			}
+			return true;
+		}
+#endif // #if defined ( __linux )
+
+		// When OutputFile_t makes its data durable, zero disables each. The default leaves it to the OS. Syncs are shared through the file's
+		// GroupCommit, so writers needing durability at the same time, through this or any other target writing the file, share one.
+		struct DurabilitySettings
+		{
+			std::chrono::milliseconds interval{ 0 };	// data is synced at the first write this long after the last sync
+			uint64_t bytes = 0;							// data is synced once this much has been written since the last sync
+			int priority = -1;							// a line of this priority or higher is synced before the writer continues, -1 disables
+		};
+
 		// Output to a File
 		template< typename ELEM_ >
 		class OutputFile_t
@@ -35,6 +125,9 @@ namespace mbp
 		public:
 			OutputFile_t( char const * const initString_ )
 				: m_opened( false )
+				, m_errors( 0 )
+				, m_ticket( 0 )
+				, m_unsynced( 0 )
 			{
 				std::stringstream filename;
 				filename << initString_;
@@ -65,32 +158,731 @@ namespace mbp
 					HANDLE file = CreateFileA( m_filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, NULL, NULL );
 					if ( file != INVALID_HANDLE_VALUE )
 					{
-						if ( INVALID_SET_FILE_POINTER != SetFilePointer( file, 0, 0, 2 ) )
+						DWORD bytesWritten = 0;
+						if ( INVALID_SET_FILE_POINTER == SetFilePointer( file, 0, 0, 2 ) || !WriteFile( file, output_, numBytes_, &bytesWritten, NULL ) || bytesWritten != numBytes_ )
+							++m_errors;
+						CloseHandle( file );
+					}
+					else
+						++m_errors;
+#elif defined ( __linux )
+					int desc = open( m_filename.c_str(), O_WRONLY );
+					if ( desc > -1 )
+					{
+						lseek( desc, 0, SEEK_END );
+						if ( write( desc, output_, numBytes_ ) != static_cast< ssize_t >( numBytes_ ) )
+							++m_errors;
+						close( desc );
+					}
+					else
+						++m_errors;
+#endif //#if defined( _MSC_VER )
+					Written( numBytes_ );
+				}
+				else
+					++m_errors;
+			}
+
+			// one open and, on Linux, one writev() for all the lines
+			void OutputV( OutputSegment_t< ELEM_ > const * segments_, size_t numSegments_ )
+			{
+				if ( !m_opened )
+					OpenAndTruncate();
+				if ( m_opened )
+				{
+#if defined( _MSC_VER )
+					HANDLE file = CreateFileA( m_filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, NULL, NULL );
+					if ( file != INVALID_HANDLE_VALUE )
+					{
+						if ( INVALID_SET_FILE_POINTER == SetFilePointer( file, 0, 0, 2 ) )
+							++m_errors;
+						else
 						{
-							DWORD bytesWritten;
-							WriteFile( file, output_, numBytes_, &bytesWritten, NULL );
+							for ( size_t i = 0; i < numSegments_; ++i )
+							{
+								DWORD bytesWritten = 0;
+								if ( !WriteFile( file, segments_[ i ].data, segments_[ i ].numBytes, &bytesWritten, NULL ) || bytesWritten != segments_[ i ].numBytes )
+									++m_errors;
+							}
 						}
 						CloseHandle( file );
 					}
+					else
+						++m_errors;
 #elif defined ( __linux )
 					int desc = open( m_filename.c_str(), O_WRONLY );
-					int numWritten;
 					if ( desc > -1 )
 					{
 						lseek( desc, 0, SEEK_END );
-						numWritten = write( desc, output_, numBytes_ );
-						if ( numWritten > -1 )
-							close( desc );
+						m_iov.resize( numSegments_ );
+						for ( size_t i = 0; i < numSegments_; ++i )
+							m_iov[ i ] = iovec{ const_cast< ELEM_ * >( segments_[ i ].data ), segments_[ i ].numBytes };
+						if ( !WriteVectored( desc, m_iov.data(), numSegments_ ) )
+							++m_errors;
+						close( desc );
 					}
+					else
+						++m_errors;
 #endif //#if defined( _MSC_VER )
+					uint64_t numBytes = 0;
+					for ( size_t i = 0; i < numSegments_; ++i )
+						numBytes += segments_[ i ].numBytes;
+					Written( numBytes );
 				}
+				else
+					++m_errors;
+			}
+
+			~OutputFile_t()
+			{
+				if ( m_durability.interval.count() || m_durability.bytes )
+					Sync();
+			}
+
+			void SetDurability( DurabilitySettings const & durability_ )
+			{
+				m_durability = durability_;
+				m_lastSync = std::chrono::steady_clock::now();
 			}
+			DurabilitySettings const & GetDurability() const { return m_durability; }
+
+			// returns once everything written through this target is on disk
+			void Sync()
+			{
+				if ( m_commit && !m_commit->Commit( m_ticket ) )
+					++m_errors;
+				m_unsynced = 0;
+				m_lastSync = std::chrono::steady_clock::now();
+			}
+
+			// called by the stream after each line, or group of lines, with the priority they were written at
+			void Commit( int priority_ )
+			{
+				if ( priority_ <= m_durability.priority && m_unsynced )
+					Sync();
+			}
+
+			uint64_t GetErrorCount() const { return m_errors; }
 
 		private:
+			void Written( uint64_t numBytes_ )
+			{
+				if ( !m_commit )
+					m_commit = AcquireGroupCommit( m_filename );
+				m_ticket = m_commit->Add( numBytes_ );
+				m_unsynced += numBytes_;
+				if ( ( m_durability.bytes && m_unsynced >= m_durability.bytes ) || ( m_durability.interval.count() && std::chrono::steady_clock::now() - m_lastSync >= m_durability.interval ) )
+					Sync();
+			}
+
+#if defined ( __linux )
+			std::vector< iovec > m_iov;
+#endif // #if defined ( __linux )
 			std::string m_filename;
 			bool m_opened;				// flags that the file has been opened and truncated successfully
+			uint64_t m_errors;			// failed opens and short or failed writes and syncs
+			DurabilitySettings m_durability;
+			std::shared_ptr< GroupCommit > m_commit;
+			uint64_t m_ticket;			// this target's last write in the file's GroupCommit
+			uint64_t m_unsynced;		// bytes written since this target last synced
+			std::chrono::steady_clock::time_point m_lastSync;
 		};
 	
+		// Output to a File as UTF8 regardless of the stream's character type. Wide producers keep their native element type while the file (and the I/O
+		// behind it) shrinks to UTF8 size: UTF32 wchar_t and char32_t buffers are up to four times larger than their UTF8 equivalent.
+		template< typename ELEM_ >
+		class OutputFileUTF8_t : public OutputFile_t< char >
+		{
+		public:
+			OutputFileUTF8_t( char const * const initString_ )
+				: OutputFile_t< char >( initString_ )
+			{}
+
+			void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+			{
+				size_t numUTF8;
+				if constexpr ( sizeof( ELEM_ ) == sizeof( char32_t ) )
+				{
+					Reserve( numCharacters_ * strings::kMaxUTF8BytesPerUTF32 );
+					numUTF8 = strings::UTF32ToUTF8( reinterpret_cast< char32_t const * >( output_ ), numCharacters_, m_transcoded.data() );
+				}
+				else if constexpr ( sizeof( ELEM_ ) == sizeof( char16_t ) )
+				{
+					Reserve( numCharacters_ * strings::kMaxUTF8BytesPerUTF16 );
+					numUTF8 = strings::UTF16ToUTF8( reinterpret_cast< char16_t const * >( output_ ), numCharacters_, m_transcoded.data() );
+				}
+				else
+				{
+					OutputFile_t< char >::Output( reinterpret_cast< char const * >( output_ ), numCharacters_, numBytes_ );
+					return;
+				}
+				m_transcoded[ numUTF8 ] = 0;
+				OutputFile_t< char >::Output( m_transcoded.data(), static_cast< uint32_t >( numUTF8 ), static_cast< uint32_t >( numUTF8 ) );
+			}
+
+		private:
+			// the transcode buffer only ever grows, so steady state output performs no allocation
+			void Reserve( size_t numBytes_ )
+			{
+				if ( m_transcoded.size() <= numBytes_ )
+					m_transcoded.resize( numBytes_ + 1 );
+			}
+			std::vector< char > m_transcoded;
+		};
+
+		// Rotation thresholds for OutputRotatingFile_t, zero disables each
+		struct RotationSettings
+		{
+			uint64_t maxBytes = 0;					// a segment is closed before the write that would take it past this size
+			std::chrono::seconds interval{ 0 };		// a segment is closed at the first write after it has been open this long
+			uint32_t keep = 0;						// segments retained, including the current one
+			bool preallocate = true;				// reserves maxBytes on disk when each segment opens
+		};
+
+		// Output to a sequence of files, rotating by size and age. The initString is a filename pattern in which %N is replaced by the segment's
+		// sequence number, starting at 0, and ".%N" is appended if the pattern has none. As with OutputFile_t, output starts afresh each run.
+		// Each target has a housekeeping thread which opens and preallocates the next segment while the current one is being written, so
+		// rotating on the writer path is a descriptor swap. The housekeeper also closes retired segments and unlinks expired ones: no segment
+		// is renamed. Segments are preallocated without changing their size, so readers never see padding, and any unused allocation is
+		// released when the segment is closed. The unused next segment is removed when the target is destroyed.
+		template< typename ELEM_ >
+		class OutputRotatingFile_t
+		{
+		public:
+			OutputRotatingFile_t( char const * const initString_ )
+				: m_pattern( initString_ ? initString_ : "" )
+				, m_sequence( 0 )
+				, m_offset( 0 )
+				, m_errors( 0 )
+				, m_next( kNoFile )
+				, m_preparing( false )
+				, m_prepareFailed( false )
+				, m_stop( false )
+			{
+				if ( std::string::npos == m_pattern.find( "%N" ) )
+					m_pattern += ".%N";
+				m_file = OpenSegment( GetCurrentFilename(), 0 );
+				m_openedAt = clock::now();
+				if ( kNoFile == m_file )
+					++m_errors;
+				m_housekeeper = std::thread( &OutputRotatingFile_t::Housekeep, this );
+			}
+			~OutputRotatingFile_t()
+			{
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					m_stop = true;
+				}
+				m_wake.notify_one();
+				m_housekeeper.join();
+				CloseSegment( m_file, m_offset );
+				if ( kNoFile != m_next )
+				{
+					CloseSegment( m_next, 0 );
+					RemoveSegment( GetFilename( m_sequence + 1 ) );
+				}
+			}
+
+			// applies to the current and the already prepared segments immediately
+			void SetRotation( RotationSettings const & rotation_ )
+			{
+				std::lock_guard< std::mutex > lock( m_mutex );
+				m_rotation = rotation_;
+				Preallocate( m_file, GetPreallocation() );
+				if ( !m_preparing )
+					Preallocate( m_next, GetPreallocation() );
+			}
+			RotationSettings const & GetRotation() const { return m_rotation; }
+
+			// swaps in the prepared segment, only opening one here if the housekeeper could not
+			void Rotate()
+			{
+				std::unique_lock< std::mutex > lock( m_mutex );
+				m_prepared.wait( lock, [ this ] { return !m_preparing; } );
+				m_retired.emplace_back( m_file, m_offset );
+				m_file = m_next;
+				m_next = kNoFile;
+				m_prepareFailed = false;
+				++m_sequence;
+				if ( m_rotation.keep && m_sequence >= m_rotation.keep )
+					m_expired.push_back( m_sequence - m_rotation.keep );
+				if ( kNoFile == m_file )
+				{
+					m_file = OpenSegment( GetCurrentFilename(), GetPreallocation() );
+					if ( kNoFile == m_file )
+						++m_errors;
+				}
+				m_offset = 0;
+				m_openedAt = clock::now();
+				lock.unlock();
+				m_wake.notify_one();
+			}
+
+			std::string GetFilename( uint64_t sequence_ ) const
+			{
+				std::string filename = m_pattern;
+				size_t pos = filename.find( "%N" );
+				filename.replace( pos, 2, std::to_string( sequence_ ) );
+				return filename;
+			}
+			std::string GetCurrentFilename() const { return GetFilename( m_sequence ); }
+
+			void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+			{
+				if ( IsRotationDue( numBytes_ ) )
+					Rotate();
+				if ( Write( output_, numBytes_ ) )
+					m_offset += numBytes_;
+				else
+					++m_errors;
+			}
+
+			uint64_t GetErrorCount() const { return m_errors; }
+
+		private:
+			using clock = std::chrono::steady_clock;
+
+			// a segment always takes its first write, however large
+			bool IsRotationDue( uint32_t numBytes_ ) const
+			{
+				return m_offset && ( ( m_rotation.maxBytes && m_offset + numBytes_ > m_rotation.maxBytes )
+					|| ( m_rotation.interval.count() && clock::now() - m_openedAt >= m_rotation.interval ) );
+			}
+			// under m_mutex
+			uint64_t GetPreallocation() const { return m_rotation.preallocate ? m_rotation.maxBytes : 0; }
+
+			// closes retired segments before unlinking expired ones, then prepares the next segment if there is none
+			void Housekeep()
+			{
+				std::unique_lock< std::mutex > lock( m_mutex );
+				for ( ;; )
+				{
+					if ( !m_retired.empty() || !m_expired.empty() )
+					{
+						std::vector< std::pair< Handle, uint64_t > > retired;
+						std::vector< uint64_t > expired;
+						retired.swap( m_retired );
+						expired.swap( m_expired );
+						lock.unlock();
+						for ( auto & i : retired )
+							CloseSegment( i.first, i.second );
+						for ( auto i : expired )
+							RemoveSegment( GetFilename( i ) );
+						lock.lock();
+					}
+					else if ( m_stop )
+						return;
+					else if ( kNoFile == m_next && !m_prepareFailed )
+					{
+						uint64_t sequence = m_sequence + 1;
+						uint64_t preallocation = GetPreallocation();
+						m_preparing = true;
+						lock.unlock();
+						Handle next = OpenSegment( GetFilename( sequence ), preallocation );
+						lock.lock();
+						m_next = next;
+						m_prepareFailed = kNoFile == next;
+						m_preparing = false;
+						m_prepared.notify_all();
+					}
+					else
+						m_wake.wait( lock );
+				}
+			}
+
+#if defined( _MSC_VER )
+			using Handle = HANDLE;
+			static inline Handle const kNoFile = INVALID_HANDLE_VALUE;
+			static Handle OpenSegment( std::string const & filename_, uint64_t preallocation_ )
+			{
+				Handle file = CreateFileA( filename_.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+				Preallocate( file, preallocation_ );
+				return file;
+			}
+			// reserving allocation leaves the end of file where it is
+			static void Preallocate( Handle file_, uint64_t preallocation_ )
+			{
+				if ( INVALID_HANDLE_VALUE != file_ && preallocation_ )
+				{
+					FILE_ALLOCATION_INFO allocation;
+					allocation.AllocationSize.QuadPart = static_cast< LONGLONG >( preallocation_ );
+					SetFileInformationByHandle( file_, FileAllocationInfo, &allocation, sizeof( allocation ) );
+				}
+			}
+			bool Write( ELEM_ const * output_, uint32_t numBytes_ )
+			{
+				DWORD bytesWritten = 0;
+				return INVALID_HANDLE_VALUE != m_file && WriteFile( m_file, output_, numBytes_, &bytesWritten, NULL ) && bytesWritten == numBytes_;
+			}
+			static void CloseSegment( Handle file_, uint64_t size_ )
+			{
+				if ( INVALID_HANDLE_VALUE != file_ )
+				{
+					FILE_ALLOCATION_INFO allocation;
+					allocation.AllocationSize.QuadPart = static_cast< LONGLONG >( size_ );
+					SetFileInformationByHandle( file_, FileAllocationInfo, &allocation, sizeof( allocation ) );
+					CloseHandle( file_ );
+				}
+			}
+			static void RemoveSegment( std::string const & filename_ ) { DeleteFileA( filename_.c_str() ); }
+#elif defined ( __linux )
+			using Handle = int;
+			static constexpr Handle kNoFile = -1;
+			static Handle OpenSegment( std::string const & filename_, uint64_t preallocation_ )
+			{
+				Handle file = open( filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+				Preallocate( file, preallocation_ );
+				return file;
+			}
+			// FALLOC_FL_KEEP_SIZE reserves the extents without moving the end of file. Filesystems without fallocate just allocate as they grow.
+			static void Preallocate( Handle file_, uint64_t preallocation_ )
+			{
+				if ( file_ >= 0 && preallocation_ )
+					( void )fallocate( file_, FALLOC_FL_KEEP_SIZE, 0, static_cast< off_t >( preallocation_ ) );
+			}
+			bool Write( ELEM_ const * output_, uint32_t numBytes_ )
+			{
+				char const * bytes = reinterpret_cast< char const * >( output_ );
+				while ( m_file >= 0 && numBytes_ )
+				{
+					ssize_t written = write( m_file, bytes, numBytes_ );
+					if ( written <= 0 )
+						return false;
+					bytes += written;
+					numBytes_ -= static_cast< uint32_t >( written );
+				}
+				return m_file >= 0;
+			}
+			// truncating to the bytes written releases any preallocation beyond them
+			static void CloseSegment( Handle file_, uint64_t size_ )
+			{
+				if ( file_ >= 0 )
+				{
+					( void )ftruncate( file_, static_cast< off_t >( size_ ) );
+					close( file_ );
+				}
+			}
+			static void RemoveSegment( std::string const & filename_ ) { unlink( filename_.c_str() ); }
+#endif //#if defined( _MSC_VER )
+
+			std::string m_pattern;
+			RotationSettings m_rotation;
+			uint64_t m_sequence;
+			uint64_t m_offset;				// bytes written to the current segment
+			clock::time_point m_openedAt;
+			uint64_t m_errors;				// failed opens and short or failed writes
+			Handle m_file;
+			// shared with the housekeeper under m_mutex
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::condition_variable m_prepared;
+			Handle m_next;											// the open segment m_sequence + 1, once prepared
+			bool m_preparing;
+			bool m_prepareFailed;									// not retried until the next rotation
+			std::vector< std::pair< Handle, uint64_t > > m_retired;	// segments to close, with the bytes written to each
+			std::vector< uint64_t > m_expired;						// sequence numbers of segments to unlink
+			bool m_stop;
+			std::thread m_housekeeper;
+			OutputRotatingFile_t( OutputRotatingFile_t const & other_ ) = delete;
+			OutputRotatingFile_t & operator=( OutputRotatingFile_t const & other_ ) = delete;
+		};
+
+#if defined ( __linux )
+		// Mapping options for OutputMmapFile_t
+		struct MmapSettings
+		{
+			enum class Sync { None, Async, Sync };
+			size_t chunkBytes = 64 * 1024 * 1024;	// the file grows and is mapped this much at a time, rounded up to whole pages
+			Sync sync = Sync::None;					// msync after every Output: Async schedules writeback, Sync waits for it
+			bool sequential = true;					// madvise( MADV_SEQUENTIAL ) on each mapping
+		};
+
+		// Output to a file through a shared memory mapping, so appending a line is a memcpy rather than a system call. The file is extended and
+		// mapped a chunk at a time, the previous chunk being unmapped as the next is mapped. Chunks are allocated with fallocate where possible,
+		// so a full disk fails the extension rather than raising SIGBUS on a later store. Until the target is destroyed the file includes the
+		// unwritten remainder of its last chunk, it is truncated to the bytes written on close. Output starts afresh each run.
+		template< typename ELEM_ >
+		class OutputMmapFile_t
+		{
+		public:
+			OutputMmapFile_t( char const * const initString_ )
+				: m_file( open( initString_, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) )
+				, m_window( nullptr )
+				, m_windowStart( 0 )
+				, m_windowBytes( 0 )
+				, m_size( 0 )
+				, m_errors( m_file < 0 ? 1 : 0 )
+			{}
+			~OutputMmapFile_t()
+			{
+				Unmap();
+				if ( m_file >= 0 )
+				{
+					( void )ftruncate( m_file, static_cast< off_t >( m_size ) );
+					close( m_file );
+				}
+			}
+
+			// a new chunk size applies from the next chunk mapped
+			void SetMapping( MmapSettings const & settings_ ) { m_settings = settings_; }
+			MmapSettings const & GetMapping() const { return m_settings; }
+
+			void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+			{
+				char const * bytes = reinterpret_cast< char const * >( output_ );
+				size_t remaining = numBytes_;
+				while ( remaining )
+				{
+					size_t offset = static_cast< size_t >( m_size - m_windowStart );
+					if ( offset == m_windowBytes && !MapNext() )
+					{
+						++m_errors;
+						return;
+					}
+					offset = static_cast< size_t >( m_size - m_windowStart );
+					size_t length = remaining < m_windowBytes - offset ? remaining : m_windowBytes - offset;
+					std::memcpy( m_window + offset, bytes, length );
+					bytes += length;
+					remaining -= length;
+					m_size += length;
+				}
+				if ( MmapSettings::Sync::None != m_settings.sync )
+					Sync( m_settings.sync );
+			}
+
+			// writes back the pages holding output not yet synced
+			void Sync( MmapSettings::Sync sync_ )
+			{
+				if ( !m_window )
+					return;
+				size_t const page = static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+				uint64_t from = ( m_synced > m_windowStart ? m_synced : m_windowStart ) / page * page;
+				if ( from < m_size && 0 != msync( m_window + ( from - m_windowStart ), static_cast< size_t >( m_size - from ), MmapSettings::Sync::Sync == sync_ ? MS_SYNC : MS_ASYNC ) )
+					++m_errors;
+				m_synced = m_size;
+			}
+
+			uint64_t GetErrorCount() const { return m_errors; }
+
+		private:
+			// extends the file by a chunk and maps it in place of the current window
+			bool MapNext()
+			{
+				if ( m_file < 0 )
+					return false;
+				size_t const page = static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+				size_t chunk = ( m_settings.chunkBytes + page - 1 ) / page * page;
+				chunk = chunk ? chunk : page;
+				uint64_t start = m_windowStart + m_windowBytes;
+				if ( 0 != fallocate( m_file, 0, static_cast< off_t >( start ), static_cast< off_t >( chunk ) )
+					&& ( EOPNOTSUPP != errno || 0 != ftruncate( m_file, static_cast< off_t >( start + chunk ) ) ) )
+					return false;
+				void * window = mmap( nullptr, chunk, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, static_cast< off_t >( start ) );
+				if ( MAP_FAILED == window )
+					return false;
+				if ( m_settings.sequential )
+					( void )madvise( window, chunk, MADV_SEQUENTIAL );
+				Unmap();
+				m_window = static_cast< char * >( window );
+				m_windowStart = start;
+				m_windowBytes = chunk;
+				return true;
+			}
+			void Unmap()
+			{
+				if ( m_window )
+				{
+					if ( MmapSettings::Sync::None != m_settings.sync )
+						Sync( m_settings.sync );
+					munmap( m_window, m_windowBytes );
+					m_window = nullptr;
+				}
+			}
+
+			int m_file;
+			MmapSettings m_settings;
+			char * m_window;				// the mapped chunk the next byte is written to
+			uint64_t m_windowStart;			// its offset in the file
+			size_t m_windowBytes;
+			uint64_t m_size;				// bytes written
+			uint64_t m_synced = 0;
+			uint64_t m_errors;				// failed opens, extensions, mappings and syncs
+			OutputMmapFile_t( OutputMmapFile_t const & other_ ) = delete;
+			OutputMmapFile_t & operator=( OutputMmapFile_t const & other_ ) = delete;
+		};
+
+		// Output to a file with O_DIRECT, bypassing the page cache so bulk logging doesn't evict the application's cached data. Output fills one
+		// of two aligned blocks while a writer thread writes the other, so the stream only waits when it fills a block before the previous one
+		// is on disk. Output reaches the file a block at a time. Flush() writes the partial block padded to the alignment and then truncates
+		// the file to its real length; the block stays in memory and is rewritten whole once it fills. Filesystems refusing O_DIRECT get the
+		// same writes through the page cache.
+		template< typename ELEM_ >
+		class OutputDirectFile_t
+		{
+		public:
+			static size_t constexpr kAlignment = 4096;
+			static size_t constexpr kBlockBytes = 1024 * 1024;
+
+			OutputDirectFile_t( char const * const initString_ )
+				: m_file( OpenDirect( initString_ ) )
+				, m_fill( 0 )
+				, m_filled( 0 )
+				, m_offset( 0 )
+				, m_pending( 0 )
+				, m_pendingOffset( 0 )
+				, m_writing( false )
+				, m_stop( false )
+				, m_errors( m_file < 0 ? 1 : 0 )
+			{
+				for ( auto & i : m_blocks )
+					i = static_cast< char * >( std::aligned_alloc( kAlignment, kBlockBytes ) );
+				m_writer = std::thread( &OutputDirectFile_t::Run, this );
+			}
+			~OutputDirectFile_t()
+			{
+				Flush();
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					m_stop = true;
+				}
+				m_wake.notify_one();
+				m_writer.join();
+				for ( auto & i : m_blocks )
+					std::free( i );
+				if ( m_file >= 0 )
+					close( m_file );
+			}
+
+			void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+			{
+				char const * bytes = reinterpret_cast< char const * >( output_ );
+				size_t remaining = numBytes_;
+				while ( remaining )
+				{
+					size_t length = remaining < kBlockBytes - m_filled ? remaining : kBlockBytes - m_filled;
+					std::memcpy( m_blocks[ m_fill ] + m_filled, bytes, length );
+					m_filled += length;
+					bytes += length;
+					remaining -= length;
+					if ( kBlockBytes == m_filled )
+						SubmitBlock();
+				}
+			}
+
+			void Flush()
+			{
+				WaitForWriter();
+				if ( m_filled )
+				{
+					size_t padded = ( m_filled + kAlignment - 1 ) / kAlignment * kAlignment;
+					std::memset( m_blocks[ m_fill ] + m_filled, 0, padded - m_filled );
+					WriteBlock( m_blocks[ m_fill ], padded, m_offset );
+					if ( m_file >= 0 && 0 != ftruncate( m_file, static_cast< off_t >( m_offset + m_filled ) ) )
+						m_errors.fetch_add( 1, std::memory_order_relaxed );
+				}
+			}
+
+			uint64_t GetErrorCount() const { return m_errors.load( std::memory_order_relaxed ); }
+
+		private:
+			static int OpenDirect( char const * filename_ )
+			{
+				int desc = open( filename_, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644 );
+				return desc < 0 && EINVAL == errno ? open( filename_, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) : desc;
+			}
+			// hands the full block to the writer once it has finished the other one, and carries on filling that
+			void SubmitBlock()
+			{
+				WaitForWriter();
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					m_pending = m_fill;
+					m_pendingOffset = m_offset;
+					m_writing = true;
+				}
+				m_wake.notify_one();
+				m_offset += kBlockBytes;
+				m_fill ^= 1;
+				m_filled = 0;
+			}
+			void WaitForWriter()
+			{
+				std::unique_lock< std::mutex > lock( m_mutex );
+				m_written.wait( lock, [ this ] { return !m_writing; } );
+			}
+			void Run()
+			{
+				std::unique_lock< std::mutex > lock( m_mutex );
+				while ( true )
+				{
+					m_wake.wait( lock, [ this ] { return m_writing || m_stop; } );
+					if ( !m_writing )
+						return;
+					lock.unlock();
+					WriteBlock( m_blocks[ m_pending ], kBlockBytes, m_pendingOffset );
+					lock.lock();
+					m_writing = false;
+					m_written.notify_one();
+				}
+			}
+			void WriteBlock( char const * block_, size_t numBytes_, uint64_t offset_ )
+			{
+				while ( m_file >= 0 && numBytes_ )
+				{
+					ssize_t written = pwrite( m_file, block_, numBytes_, static_cast< off_t >( offset_ ) );
+					if ( written <= 0 )
+					{
+						if ( written < 0 && EINTR == errno )
+							continue;
+						break;
+					}
+					block_ += written;
+					numBytes_ -= static_cast< size_t >( written );
+					offset_ += static_cast< uint64_t >( written );
+				}
+				if ( numBytes_ )
+					m_errors.fetch_add( 1, std::memory_order_relaxed );
+			}
+
+			int m_file;
+			char * m_blocks[ 2 ];
+			size_t m_fill;					// the block being filled
+			size_t m_filled;				// and the bytes in it
+			uint64_t m_offset;				// the file offset of its first byte
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::condition_variable m_written;
+			size_t m_pending;				// the block being written, while m_writing
+			uint64_t m_pendingOffset;
+			bool m_writing;
+			bool m_stop;
+			std::atomic< uint64_t > m_errors;	// failed opens and short or failed writes
+			std::thread m_writer;
+			OutputDirectFile_t( OutputDirectFile_t const & other_ ) = delete;
+			OutputDirectFile_t & operator=( OutputDirectFile_t const & other_ ) = delete;
+		};
+
+		// Output to a file through io_uring, see UringWriter. Output() returns once the line is queued, so lines reach the file asynchronously
+		// and in order, all of them by the time the target is destroyed. Falls back to write() where io_uring is unavailable.
+		template< typename ELEM_ >
+		class OutputUringFile_t
+		{
+		public:
+			OutputUringFile_t( char const * const initString_ )
+				: m_writer( initString_ )
+			{}
+			void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+			{
+				m_writer.Write( output_, numBytes_ );
+			}
+			void Flush() { m_writer.Flush(); }
+			bool IsUsingUring() const { return m_writer.IsUsingUring(); }
+			uint64_t GetErrorCount() const { return m_writer.GetErrorCount(); }
+		private:
+			UringWriter m_writer;
+		};
+#endif // #if defined ( __linux )
+
 		// Output to std::cout or std::wcout (latter requires USE_STD_WCOUT defined)
 		template< typename ELEM_ >
 		class OutputStdOut_t
@@ -98,11 +890,19 @@ namespace mbp
 		public:
 			OutputStdOut_t( char const * const initString_ = nullptr )
 			{}
+			static char const * GetDefaultName() { return "stdout"; }
 			void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
 			{
 				std::cout.write( reinterpret_cast< char const * >( output_ ), numCharacters_ * sizeof( ELEM_ ) );
 				std::cout.flush();
 			}
+			// std::cout gathers the lines and a single flush passes them on, so output stays ordered with other users of std::cout
+			void OutputV( OutputSegment_t< ELEM_ > const * segments_, size_t numSegments_ )
+			{
+				for ( size_t i = 0; i < numSegments_; ++i )
+					std::cout.write( reinterpret_cast< char const * >( segments_[ i ].data ), segments_[ i ].numCharacters * sizeof( ELEM_ ) );
+				std::cout.flush();
+			}
 		};
 	
 		template<>
@@ -117,6 +917,211 @@ namespace mbp
 #endif // #if defined( _MSC_VER )
 		}
 
+		template<>
+		inline void OutputStdOut_t< wchar_t >::OutputV( OutputSegment_t< wchar_t > const * segments_, size_t numSegments_ )
+		{
+#if defined ( USE_STD_WCOUT )
+			for ( size_t i = 0; i < numSegments_; ++i )
+				std::wcout.write( segments_[ i ].data, segments_[ i ].numCharacters );
+			std::wcout.flush();
+#else
+			for ( size_t i = 0; i < numSegments_; ++i )
+				std::cout.write( reinterpret_cast< char const * >( segments_[ i ].data ), segments_[ i ].numCharacters * sizeof( wchar_t ) );
+			std::cout.flush();
+#endif // #if defined ( USE_STD_WCOUT )
+		}
+
+		// Output straight to the stdout or stderr descriptor, bypassing iostreams and their locking. The initString selects "stderr", a descriptor
+		// number such as one passed down by a supervisor, or by default stdout. A terminal is written a line at a time, as each arrives. A pipe or
+		// file gets lines gathered into a buffer, written when it fills, on Flush() and at least every flush interval by a timer thread, so a
+		// quiet process's last lines still arrive promptly. As this doesn't go through std::cout, it only keeps order with other writers to the
+		// descriptor at write boundaries.
+		template< typename ELEM_ >
+		class OutputStdFd_t
+		{
+		public:
+			static size_t constexpr kBufferBytes = 64 * 1024;
+
+			OutputStdFd_t( char const * const initString_ = nullptr )
+				: m_file( SelectFile( initString_ ) )
+				, m_interactive( IsTerminal( m_file ) )
+				, m_filled( 0 )
+				, m_flushInterval( 100 )
+				, m_stop( false )
+				, m_errors( 0 )
+			{
+				if ( !m_interactive )
+				{
+					m_buffer.reset( new char[ kBufferBytes ] );
+					m_timer = std::thread( &OutputStdFd_t::Run, this );
+				}
+			}
+			~OutputStdFd_t()
+			{
+				if ( m_timer.joinable() )
+				{
+					{
+						std::lock_guard< std::mutex > lock( m_mutex );
+						m_stop = true;
+					}
+					m_wake.notify_one();
+					m_timer.join();
+				}
+				Flush();
+			}
+
+			void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+			{
+				if ( m_interactive )
+					WriteAll( reinterpret_cast< char const * >( output_ ), numBytes_ );
+				else
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					Append( reinterpret_cast< char const * >( output_ ), numBytes_ );
+				}
+			}
+
+			void OutputV( OutputSegment_t< ELEM_ > const * segments_, size_t numSegments_ )
+			{
+				if ( m_interactive )
+				{
+#if defined ( __linux )
+					m_iov.resize( numSegments_ );
+					for ( size_t i = 0; i < numSegments_; ++i )
+						m_iov[ i ] = iovec{ const_cast< ELEM_ * >( segments_[ i ].data ), segments_[ i ].numBytes };
+					if ( !WriteVectored( m_file, m_iov.data(), numSegments_ ) )
+						m_errors.fetch_add( 1, std::memory_order_relaxed );
+#else
+					for ( size_t i = 0; i < numSegments_; ++i )
+						WriteAll( reinterpret_cast< char const * >( segments_[ i ].data ), segments_[ i ].numBytes );
+#endif // #if defined ( __linux )
+				}
+				else
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					for ( size_t i = 0; i < numSegments_; ++i )
+						Append( reinterpret_cast< char const * >( segments_[ i ].data ), segments_[ i ].numBytes );
+				}
+			}
+
+			// writes any buffered output now
+			void Flush()
+			{
+				std::lock_guard< std::mutex > lock( m_mutex );
+				WriteBuffer();
+			}
+
+			// the longest buffered output waits before the timer writes it, zero leaves it until the buffer fills or Flush()
+			void SetFlushInterval( std::chrono::milliseconds interval_ )
+			{
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					m_flushInterval = interval_;
+				}
+				m_wake.notify_one();
+			}
+
+			// a stream given "stderr" or a descriptor number is named by it
+			static char const * GetDefaultName() { return "stdout"; }
+			bool IsInteractive() const { return m_interactive; }
+			uint64_t GetErrorCount() const { return m_errors.load( std::memory_order_relaxed ); }
+
+		private:
+#if defined ( _MSC_VER )
+			using File = HANDLE;
+			static File SelectFile( char const * initString_ )
+			{
+				if ( initString_ && 0 == std::strcmp( initString_, "stderr" ) )
+					return GetStdHandle( STD_ERROR_HANDLE );
+				return GetStdHandle( STD_OUTPUT_HANDLE );
+			}
+			static bool IsTerminal( File file_ ) { return FILE_TYPE_CHAR == GetFileType( file_ ); }
+#else
+			using File = int;
+			static File SelectFile( char const * initString_ )
+			{
+				if ( initString_ && 0 == std::strcmp( initString_, "stderr" ) )
+					return STDERR_FILENO;
+				if ( initString_ && *initString_ >= '0' && *initString_ <= '9' )
+					return std::atoi( initString_ );
+				return STDOUT_FILENO;
+			}
+			static bool IsTerminal( File file_ ) { return 1 == isatty( file_ ); }
+#endif // #if defined ( _MSC_VER )
+
+			void WriteAll( char const * bytes_, size_t numBytes_ )
+			{
+				while ( numBytes_ )
+				{
+#if defined ( _MSC_VER )
+					DWORD written = 0;
+					if ( !WriteFile( m_file, bytes_, static_cast< DWORD >( numBytes_ ), &written, NULL ) || !written )
+						break;
+#else
+					ssize_t written = write( m_file, bytes_, numBytes_ );
+					if ( written <= 0 )
+					{
+						if ( written < 0 && EINTR == errno )
+							continue;
+						break;
+					}
+#endif // #if defined ( _MSC_VER )
+					bytes_ += written;
+					numBytes_ -= static_cast< size_t >( written );
+				}
+				if ( numBytes_ )
+					m_errors.fetch_add( 1, std::memory_order_relaxed );
+			}
+			// caller holds m_mutex. Output too large to buffer is written directly, after whatever is buffered.
+			void Append( char const * bytes_, size_t numBytes_ )
+			{
+				if ( numBytes_ > kBufferBytes - m_filled )
+					WriteBuffer();
+				if ( numBytes_ >= kBufferBytes )
+					WriteAll( bytes_, numBytes_ );
+				else
+				{
+					std::memcpy( m_buffer.get() + m_filled, bytes_, numBytes_ );
+					m_filled += numBytes_;
+				}
+			}
+			// caller holds m_mutex
+			void WriteBuffer()
+			{
+				if ( m_filled )
+					WriteAll( m_buffer.get(), m_filled );
+				m_filled = 0;
+			}
+			void Run()
+			{
+				std::unique_lock< std::mutex > lock( m_mutex );
+				while ( !m_stop )
+				{
+					if ( m_flushInterval.count() )
+						m_wake.wait_for( lock, m_flushInterval );
+					else
+						m_wake.wait( lock );
+					WriteBuffer();
+				}
+			}
+
+			File m_file;
+			bool m_interactive;
+			std::unique_ptr< char[] > m_buffer;	// only when not interactive
+			size_t m_filled;
+#if defined ( __linux )
+			std::vector< iovec > m_iov;
+#endif // #if defined ( __linux )
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::chrono::milliseconds m_flushInterval;
+			bool m_stop;
+			std::atomic< uint64_t > m_errors;	// short or failed writes
+			std::thread m_timer;
+			OutputStdFd_t( OutputStdFd_t const & other_ ) = delete;
+			OutputStdFd_t & operator=( OutputStdFd_t const & other_ ) = delete;
+		};
+
 		// A memory buffer output target. Really just for my test suite so not optimised in any way. Reallocations just attempt to double the current buffer size until we reach a maximum doubling value, beyond which that value is used as an incremental addition.
 		auto constexpr kInitialChunkSize = 1024;
 		auto constexpr kMaxBeforeAddition = kInitialChunkSize * kInitialChunkSize;
@@ -195,6 +1200,149 @@ namespace mbp
 			ELEM_ * m_pBase;
 		};
 
+		// Output to a bounded in-memory ring that always holds the latest output, see FlightRecorder. Recording is a copy into the ring, so
+		// verbose diagnostics can be kept cheaply and written out only when wanted: on demand with Dump() or DumpToFile(), or automatically
+		// when a line at the trigger priority or higher is output, whether written to the stream or published to it by an OutputChannel.
+		// Triggered dumps are written by the target's own thread, started by SetTrigger(), so the line's writer only signals it; the dump
+		// holds the ring as it is when the thread reads it, which includes the trigger line. The initString names a recorder shared by every
+		// target given the same name, which producers on any number of streams record to concurrently without locking; create it with
+		// AcquireFlightRecorder() first for a capacity other than the default. A null or empty name gives the target a recorder of its own.
+		template< typename ELEM_ >
+		class OutputFlightRecorder_t
+		{
+		public:
+			OutputFlightRecorder_t( char const * const initString_ = nullptr )
+				: OutputFlightRecorder_t( AcquireFlightRecorder( initString_ ? initString_ : "" ), 0 )
+			{}
+			~OutputFlightRecorder_t()
+			{
+				if ( !m_dumper.joinable() )
+					return;
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					m_stop = true;
+				}
+				m_wake.notify_one();
+				m_dumper.join();
+			}
+
+			void Output( ELEM_ const * output_, uint32_t numCharacters_, uint32_t numBytes_ )
+			{
+				m_recorder->Record( output_, numBytes_ );
+			}
+
+			// a line of priority_ or higher dumps the ring to filename_, replacing any previous dump. -1 disables.
+			void SetTrigger( int priority_, std::string const & filename_ )
+			{
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					m_triggerFilename = filename_;
+				}
+				m_triggerPriority.store( priority_, std::memory_order_relaxed );
+				if ( priority_ >= 0 && !m_dumper.joinable() )
+					m_dumper = std::thread( &OutputFlightRecorder_t::RunDumper, this );
+			}
+			void Commit( int priority_ )
+			{
+				if ( priority_ > m_triggerPriority.load( std::memory_order_relaxed ) )
+					return;
+				{
+					std::lock_guard< std::mutex > lock( m_mutex );
+					++m_dumpsRequested;
+				}
+				m_wake.notify_one();
+			}
+			// returns once every dump triggered so far has been written
+			void WaitForDumps()
+			{
+				std::unique_lock< std::mutex > lock( m_mutex );
+				m_dumped.wait( lock, [ this ] { return m_dumpsWritten >= m_dumpsRequested; } );
+			}
+
+			// writes each record in the ring, oldest first, to stream_ as a line of its own
+			void Dump( std::basic_ostream< ELEM_, std::char_traits< ELEM_ > > & stream_ ) const
+			{
+				m_recorder->ForEach( [ &stream_ ]( char const * data_, size_t numBytes_ )
+				{
+					stream_.write( reinterpret_cast< ELEM_ const * >( data_ ), static_cast< std::streamsize >( numBytes_ / sizeof( ELEM_ ) ) );
+					stream_.flush();
+				} );
+			}
+			// writes the ring now, on the calling thread
+			void DumpToFile( char const * filename_ )
+			{
+				if ( !m_recorder->DumpToFile( filename_ ) )
+					m_errors.fetch_add( 1, std::memory_order_relaxed );
+			}
+
+			FlightRecorder & GetRecorder() { return *m_recorder; }
+			uint64_t GetErrorCount() const { return m_errors.load( std::memory_order_relaxed ); }
+
+		protected:
+			OutputFlightRecorder_t( std::shared_ptr< FlightRecorder > recorder_, uint64_t errors_ )
+				: m_recorder( std::move( recorder_ ) )
+				, m_triggerPriority( -1 )
+				, m_errors( errors_ )
+				, m_dumpsRequested( 0 )
+				, m_dumpsWritten( 0 )
+				, m_stop( false )
+			{}
+
+		private:
+			// triggers arriving while a dump is written are covered by the next one, so a burst of them costs at most two dumps
+			void RunDumper()
+			{
+				std::unique_lock< std::mutex > lock( m_mutex );
+				for ( ;; )
+				{
+					if ( m_dumpsWritten < m_dumpsRequested )
+					{
+						uint64_t requested = m_dumpsRequested;
+						std::string filename = m_triggerFilename;
+						lock.unlock();
+						DumpToFile( filename.c_str() );
+						lock.lock();
+						m_dumpsWritten = requested;
+						m_dumped.notify_all();
+					}
+					else if ( m_stop )
+						return;
+					else
+						m_wake.wait( lock );
+				}
+			}
+
+			std::shared_ptr< FlightRecorder > m_recorder;
+			std::atomic< int > m_triggerPriority;
+			std::atomic< uint64_t > m_errors;	// failed dumps, and a failed shared mapping
+			// shared with the dumper under m_mutex
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::condition_variable m_dumped;
+			std::string m_triggerFilename;
+			uint64_t m_dumpsRequested;
+			uint64_t m_dumpsWritten;
+			bool m_stop;
+			std::thread m_dumper;
+		};
+
+		// A flight recorder whose ring lives in a shared memory object ( "/name" ) or file named by the initString, see OpenSharedFlightRecorder().
+		// Output is only ever a copy into the mapping, yet everything recorded survives the process crashing or being killed, for streamtail
+		// to read afterwards. If the ring can't be mapped, output goes to a ring in the process's own memory and an error is counted.
+		template< typename ELEM_ >
+		class OutputSharedRecorder_t : public OutputFlightRecorder_t< ELEM_ >
+		{
+		public:
+			OutputSharedRecorder_t( char const * const initString_ )
+				: OutputSharedRecorder_t( initString_ ? OpenSharedFlightRecorder( initString_ ) : nullptr )
+			{}
+
+		private:
+			OutputSharedRecorder_t( std::shared_ptr< FlightRecorder > recorder_ )
+				: OutputFlightRecorder_t< ELEM_ >( recorder_ ? recorder_ : AcquireFlightRecorder( "" ), recorder_ ? 0 : 1 )
+			{}
+		};
+
 		/////////////////////////////////////////
 		/// Windows only OutputTarget examples
 		/////////////////////////////////////////
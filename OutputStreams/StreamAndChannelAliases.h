@@ -14,6 +14,9 @@
 #define StreamAndChannelAliases_DEFINED_7_7_2022
 
 #include "OutputChannels.h"
+#include "CompiledFilter.h"
+#include "CallSites.h"
+#include "ControlBlock.h"
 
 namespace mbp
 {
@@ -36,8 +39,26 @@ namespace mbp
 		// helper aliases
 		template< typename T_, template< typename > typename U_ = Stream_t >
 		using StreamFile = OutputStream_t< T_, OutputFile_t, U_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamFileUTF8 = OutputStream_t< T_, OutputFileUTF8_t, U_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamRotatingFile = OutputStream_t< T_, OutputRotatingFile_t, U_ >;
+#if defined (__linux)
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamMmapFile = OutputStream_t< T_, OutputMmapFile_t, U_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamUringFile = OutputStream_t< T_, OutputUringFile_t, U_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamDirectFile = OutputStream_t< T_, OutputDirectFile_t, U_ >;
+#endif // #if defined (__linux)
 		template< typename T_, template< typename > typename U_ = Stream_t >
 		using StreamStdOut = OutputStream_t< T_, OutputStdOut_t, U_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamStdFd = OutputStream_t< T_, OutputStdFd_t, U_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamFlightRecorder = OutputStream_t< T_, OutputFlightRecorder_t, U_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamSharedRecorder = OutputStream_t< T_, OutputSharedRecorder_t, U_ >;
 #if defined (_MSC_VER)
 		template< typename T_, template< typename > typename U_ = Stream_t >
 		using StreamConsole = OutputStream_t< T_, OutputConsole_t, U_ >;
@@ -46,6 +67,10 @@ namespace mbp
 #endif // #if defined (_MSC_VER)
 		template< typename T_ >
 		using StreamList = std::vector < BasicStream_t< T_ > * >;
+		template< typename T_ >
+		using ChannelConnector = ChannelConnector_t< T_ >;
+		template< template< typename > typename U_ = Stream_t >
+		using MetricsDumper = MetricsDumper_t< U_ >;
 #if defined( STREAM_TEST_SUITE )
 		template< typename T_, template< typename > typename U_ = Stream_t >
 		using StreamMem = OutputStream_t< T_, OutputMem_t, U_ >;
@@ -65,10 +90,32 @@ namespace mbp
 		// helper types
 		template< typename T_, template< typename > typename U_ = Stream_t >
 		using StreamFile = NullStream_t< T_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamFileUTF8 = NullStream_t< T_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamRotatingFile = NullStream_t< T_ >;
+#if defined (__linux)
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamMmapFile = NullStream_t< T_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamUringFile = NullStream_t< T_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamDirectFile = NullStream_t< T_ >;
+#endif // #if defined (__linux)
 		template< typename T_, template< typename > typename U_ = Stream_t >
 		using StreamStdOut = NullStream_t< T_ >;
 		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamStdFd = NullStream_t< T_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamFlightRecorder = NullStream_t< T_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
+		using StreamSharedRecorder = NullStream_t< T_ >;
+		template< typename T_, template< typename > typename U_ = Stream_t >
 		using StreamList = NullStream_t< T_ >;
+		template< typename T_ >
+		using ChannelConnector = NullStream_t< T_ >;
+		template< template< typename > typename U_ = Stream_t >
+		using MetricsDumper = NullStream_t< char >;
 		template< typename T_, template< typename > typename U_ = Stream_t >
 		using OutputChannel = NullStream_t< T_ >;
 #if defined (_MSC_VER)
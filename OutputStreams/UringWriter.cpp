@@ -0,0 +1,277 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	UringWriter.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: io_uring setup, submission and completion through the raw system calls, with a write() fallback
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "UringWriter.h"
+
+#if defined( __linux )
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace mbp
+{
+	namespace streams
+	{
+		namespace
+		{
+			unsigned constexpr kQueueDepth = 16;
+
+			int SetupSyscall( unsigned entries_, io_uring_params * params_ )
+			{
+				return static_cast< int >( syscall( __NR_io_uring_setup, entries_, params_ ) );
+			}
+			int EnterSyscall( int ring_, unsigned toSubmit_, unsigned minComplete_, unsigned flags_ )
+			{
+				return static_cast< int >( syscall( __NR_io_uring_enter, ring_, toSubmit_, minComplete_, flags_, nullptr, 0 ) );
+			}
+			int RegisterSyscall( int ring_, unsigned opcode_, void const * arg_, unsigned numArgs_ )
+			{
+				return static_cast< int >( syscall( __NR_io_uring_register, ring_, opcode_, arg_, numArgs_ ) );
+			}
+		}
+
+		// the three shared mappings and the ring fields within them. The heads and tails are shared with the kernel, which reads the submission
+		// tail and the completion head we write and writes the others.
+		struct UringWriter::Ring
+		{
+			void * sqMapping = MAP_FAILED;
+			size_t sqMappingBytes = 0;
+			void * cqMapping = MAP_FAILED;
+			size_t cqMappingBytes = 0;
+			io_uring_sqe * sqes = static_cast< io_uring_sqe * >( MAP_FAILED );
+			size_t sqesBytes = 0;
+
+			unsigned * sqTail = nullptr;
+			unsigned sqMask = 0;
+			unsigned * sqArray = nullptr;
+			unsigned * cqHead = nullptr;
+			unsigned * cqTail = nullptr;
+			unsigned cqMask = 0;
+			io_uring_cqe * cqes = nullptr;
+
+			~Ring()
+			{
+				if ( MAP_FAILED != static_cast< void * >( sqes ) )
+					munmap( sqes, sqesBytes );
+				if ( MAP_FAILED != cqMapping && cqMapping != sqMapping )
+					munmap( cqMapping, cqMappingBytes );
+				if ( MAP_FAILED != sqMapping )
+					munmap( sqMapping, sqMappingBytes );
+			}
+		};
+
+		UringWriter::UringWriter( char const * filename_ )
+			: m_file( open( filename_, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) )
+			, m_ring( -1 )
+			, m_storage( nullptr )
+			, m_current( 0 )
+			, m_inFlight( 0 )
+			, m_offset( 0 )
+			, m_errors( m_file < 0 ? 1 : 0 )
+		{
+			void * storage = mmap( nullptr, kNumBuffers * kBufferBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+			if ( MAP_FAILED == storage )
+				return;
+			m_storage = static_cast< char * >( storage );
+			for ( size_t i = 0; i < kNumBuffers; ++i )
+				m_buffers[ i ] = Buffer{ m_storage + i * kBufferBytes, 0, 0, false };
+			if ( m_file >= 0 && !SetupRing() )
+			{
+				if ( m_ring >= 0 )
+					close( m_ring );
+				m_ring = -1;
+				m_rings.reset();
+			}
+		}
+
+		UringWriter::~UringWriter()
+		{
+			Flush();
+			m_rings.reset();
+			if ( m_ring >= 0 )
+				close( m_ring );
+			if ( m_storage )
+				munmap( m_storage, kNumBuffers * kBufferBytes );
+			if ( m_file >= 0 )
+				close( m_file );
+		}
+
+		bool UringWriter::SetupRing()
+		{
+			io_uring_params params;
+			std::memset( &params, 0, sizeof( params ) );
+			m_ring = SetupSyscall( kQueueDepth, &params );
+			if ( m_ring < 0 )
+				return false;
+
+			m_rings.reset( new Ring );
+			Ring & ring = *m_rings;
+			ring.sqMappingBytes = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+			ring.cqMappingBytes = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+			bool const singleMapping = 0 != ( params.features & IORING_FEAT_SINGLE_MMAP );
+			if ( singleMapping )
+				ring.sqMappingBytes = ring.cqMappingBytes = ring.sqMappingBytes > ring.cqMappingBytes ? ring.sqMappingBytes : ring.cqMappingBytes;
+			ring.sqMapping = mmap( nullptr, ring.sqMappingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING );
+			if ( MAP_FAILED == ring.sqMapping )
+				return false;
+			ring.cqMapping = singleMapping ? ring.sqMapping : mmap( nullptr, ring.cqMappingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING );
+			if ( MAP_FAILED == ring.cqMapping )
+				return false;
+			ring.sqesBytes = params.sq_entries * sizeof( io_uring_sqe );
+			ring.sqes = static_cast< io_uring_sqe * >( mmap( nullptr, ring.sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES ) );
+			if ( MAP_FAILED == static_cast< void * >( ring.sqes ) )
+				return false;
+
+			char * sq = static_cast< char * >( ring.sqMapping );
+			char * cq = static_cast< char * >( ring.cqMapping );
+			ring.sqTail = reinterpret_cast< unsigned * >( sq + params.sq_off.tail );
+			ring.sqMask = *reinterpret_cast< unsigned * >( sq + params.sq_off.ring_mask );
+			ring.sqArray = reinterpret_cast< unsigned * >( sq + params.sq_off.array );
+			ring.cqHead = reinterpret_cast< unsigned * >( cq + params.cq_off.head );
+			ring.cqTail = reinterpret_cast< unsigned * >( cq + params.cq_off.tail );
+			ring.cqMask = *reinterpret_cast< unsigned * >( cq + params.cq_off.ring_mask );
+			ring.cqes = reinterpret_cast< io_uring_cqe * >( cq + params.cq_off.cqes );
+
+			// fixed buffers save the kernel mapping the pages on every write
+			iovec buffers[ kNumBuffers ];
+			for ( size_t i = 0; i < kNumBuffers; ++i )
+				buffers[ i ] = iovec{ m_buffers[ i ].data, kBufferBytes };
+			return 0 == RegisterSyscall( m_ring, IORING_REGISTER_BUFFERS, buffers, kNumBuffers );
+		}
+
+		void UringWriter::Write( void const * data_, size_t numBytes_ )
+		{
+			if ( m_file < 0 )
+			{
+				++m_errors;
+				return;
+			}
+			if ( m_ring < 0 || !m_storage )
+			{
+				WriteDirect( data_, numBytes_, m_offset );
+				m_offset += numBytes_;
+				return;
+			}
+			char const * bytes = static_cast< char const * >( data_ );
+			while ( numBytes_ )
+			{
+				Buffer & buffer = m_buffers[ m_current ];
+				size_t length = numBytes_ < kBufferBytes - buffer.length ? numBytes_ : kBufferBytes - buffer.length;
+				std::memcpy( buffer.data + buffer.length, bytes, length );
+				buffer.length += length;
+				bytes += length;
+				numBytes_ -= length;
+				Reap( 0 );
+				if ( buffer.length == kBufferBytes || 0 == m_inFlight )
+					Submit( m_current );
+			}
+		}
+
+		void UringWriter::Flush()
+		{
+			if ( m_ring < 0 )
+				return;
+			if ( m_buffers[ m_current ].length )
+				Submit( m_current );
+			while ( m_inFlight )
+				Reap( 1 );
+		}
+
+		void UringWriter::Submit( size_t buffer_ )
+		{
+			Buffer & buffer = m_buffers[ buffer_ ];
+			Ring & ring = *m_rings;
+			unsigned tail = *ring.sqTail;
+			unsigned index = tail & ring.sqMask;
+			io_uring_sqe & sqe = ring.sqes[ index ];
+			std::memset( &sqe, 0, sizeof( sqe ) );
+			sqe.opcode = IORING_OP_WRITE_FIXED;
+			sqe.fd = m_file;
+			sqe.off = m_offset;
+			sqe.addr = reinterpret_cast< uint64_t >( buffer.data );
+			sqe.len = static_cast< uint32_t >( buffer.length );
+			sqe.buf_index = static_cast< uint16_t >( buffer_ );
+			sqe.user_data = buffer_;
+			ring.sqArray[ index ] = index;
+			__atomic_store_n( ring.sqTail, tail + 1, __ATOMIC_RELEASE );
+			buffer.offset = m_offset;
+			buffer.inFlight = true;
+			++m_inFlight;
+			m_offset += buffer.length;
+
+			int submitted;
+			while ( ( submitted = EnterSyscall( m_ring, 1, 0, 0 ) ) < 0 && ( EINTR == errno || EAGAIN == errno || EBUSY == errno ) )
+				Reap( m_inFlight > 1 ? 1 : 0 );
+			if ( submitted < 1 )
+			{
+				// the entry was never consumed, so the write is made here and the ring's tail restored
+				__atomic_store_n( ring.sqTail, tail, __ATOMIC_RELEASE );
+				WriteDirect( buffer.data, buffer.length, buffer.offset );
+				buffer.inFlight = false;
+				buffer.length = 0;
+				--m_inFlight;
+			}
+
+			// the next buffer in turn is filled once its previous write has completed
+			m_current = ( buffer_ + 1 ) % kNumBuffers;
+			while ( m_buffers[ m_current ].inFlight )
+				Reap( 1 );
+		}
+
+		void UringWriter::Reap( unsigned minComplete_ )
+		{
+			Ring & ring = *m_rings;
+			if ( minComplete_ && __atomic_load_n( ring.cqTail, __ATOMIC_ACQUIRE ) == *ring.cqHead )
+				EnterSyscall( m_ring, 0, minComplete_, IORING_ENTER_GETEVENTS );
+			unsigned head = *ring.cqHead;
+			unsigned tail = __atomic_load_n( ring.cqTail, __ATOMIC_ACQUIRE );
+			for ( ; head != tail; ++head )
+			{
+				io_uring_cqe const & cqe = ring.cqes[ head & ring.cqMask ];
+				Buffer & buffer = m_buffers[ cqe.user_data ];
+				// a short write is finished directly, a failed one is counted
+				if ( cqe.res < 0 )
+					++m_errors;
+				else if ( static_cast< size_t >( cqe.res ) < buffer.length )
+					WriteDirect( buffer.data + cqe.res, buffer.length - cqe.res, buffer.offset + cqe.res );
+				buffer.inFlight = false;
+				buffer.length = 0;
+				--m_inFlight;
+			}
+			__atomic_store_n( ring.cqHead, head, __ATOMIC_RELEASE );
+		}
+
+		void UringWriter::WriteDirect( void const * data_, size_t numBytes_, uint64_t offset_ )
+		{
+			char const * bytes = static_cast< char const * >( data_ );
+			while ( numBytes_ )
+			{
+				ssize_t written = pwrite( m_file, bytes, numBytes_, static_cast< off_t >( offset_ ) );
+				if ( written <= 0 )
+				{
+					if ( written < 0 && EINTR == errno )
+						continue;
+					++m_errors;
+					return;
+				}
+				bytes += written;
+				numBytes_ -= static_cast< size_t >( written );
+				offset_ += static_cast< uint64_t >( written );
+			}
+		}
+	}
+}
+#endif // #if defined( __linux )
@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+///	Filename: 	UringWriter.h
+///	Created:	19/10/2026
+///	Author:		Mike Brown
+///
+///	Description: Appends to a file through an io_uring, used by OutputUringFile_t
+///
+///				 Output is copied into one of a small set of registered buffers. A buffer is submitted as a fixed buffer write when it
+///				 fills or when nothing is in flight, so a lone line goes straight out while lines arriving during a write gather into
+///				 the next one. Completions are reaped from the shared ring without a system call; the writer only waits in the kernel
+///				 when every buffer is in flight, or when flushing. The ring is driven through the raw system calls, so there is no
+///				 dependency on liburing. Where io_uring is unavailable or forbidden, writes fall back to write() with the same results.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef UringWriter_DEFINED_19_10_2026
+#define UringWriter_DEFINED_19_10_2026
+
+#if defined( __linux )
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mbp
+{
+	namespace streams
+	{
+		class UringWriter
+		{
+		public:
+			static size_t constexpr kNumBuffers = 8;
+			static size_t constexpr kBufferBytes = 64 * 1024;
+
+			// truncates or creates the file
+			explicit UringWriter( char const * filename_ );
+			~UringWriter();
+
+			void Write( void const * data_, size_t numBytes_ );
+			// submits any buffered output and waits for every write to complete
+			void Flush();
+
+			bool IsUsingUring() const { return m_ring >= 0; }
+			uint64_t GetErrorCount() const { return m_errors; }
+
+		private:
+			struct Ring;
+			struct Buffer
+			{
+				char * data;
+				size_t length;
+				uint64_t offset;				// where it is being written, while in flight
+				bool inFlight;
+			};
+
+			bool SetupRing();
+			void Submit( size_t buffer_ );
+			// handles every completion posted so far, waiting for at least minComplete_ of them
+			void Reap( unsigned minComplete_ );
+			void WriteDirect( void const * data_, size_t numBytes_, uint64_t offset_ );
+
+			int m_file;
+			int m_ring;
+			std::unique_ptr< Ring > m_rings;
+			char * m_storage;				// the buffers, mapped as one page aligned block
+			Buffer m_buffers[ kNumBuffers ];
+			size_t m_current;				// the buffer being filled
+			size_t m_inFlight;
+			uint64_t m_offset;				// the file offset the next buffer submitted is written at
+			uint64_t m_errors;				// failed opens and short or failed writes
+
+			UringWriter( UringWriter const & other_ ) = delete;
+			UringWriter & operator=( UringWriter const & other_ ) = delete;
+		};
+	}
+}
+#endif // #if defined( __linux )
+
+#endif // #ifndef UringWriter_DEFINED_19_10_2026
@@ -10,6 +10,7 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include "StreamTest.h"
+#include "StreamTestStrings.h"
 
 #if defined(_MSC_VER)
 #include <crtdbg.h>
@@ -20,98 +21,16 @@
 #include <chrono>
 #include <random>
 #include <thread>
+#if defined( __linux )
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif // #if defined( __linux )
 
 using namespace mbp;
 using namespace std::chrono;
 
-//////////////////////////////////////////////////////////////////////////
-/// Test Strings in UTF8
-//	From https://www.kermitproject.org/utf8.html
-//////////////////////////////////////////////////////////////////////////
-
-const char * utf8StringOne =
-u8R"(From the Anglo-Saxon Rune Poem (Rune version):
-ᚠᛇᚻ᛫ᛒᛦᚦ᛫ᚠᚱᚩᚠᚢᚱ᛫ᚠᛁᚱᚪ᛫ᚷᛖᚻᚹᛦᛚᚳᚢᛗ
-ᛋᚳᛖᚪᛚ᛫ᚦᛖᚪᚻ᛫ᛗᚪᚾᚾᚪ᛫ᚷᛖᚻᚹᛦᛚᚳ᛫ᛗᛁᚳᛚᚢᚾ᛫ᚻᛦᛏ᛫ᛞᚫᛚᚪᚾ
-ᚷᛁᚠ᛫ᚻᛖ᛫ᚹᛁᛚᛖ᛫ᚠᚩᚱ᛫ᛞᚱᛁᚻᛏᚾᛖ᛫ᛞᚩᛗᛖᛋ᛫ᚻᛚᛇᛏᚪᚾ᛬)";
-const char * utf8StringTwo =
-u8R"(From Laȝamon's Brut (The Chronicles of England, Middle English, West Midlands, ca.1190):
-An preost wes on leoden, Laȝamon was ihoten
-He wes Leovenaðes sone -- liðe him be Drihten.
-He wonede at Ernleȝe at æðelen are chirechen,
-Uppen Sevarne staþe, sel þar him þuhte,
-Onfest Radestone, þer he bock radde.
-(The third letter in the author's name is Yogh, missing from many fonts; CLICK HERE for another Middle English sample with some explanation of letters and encoding).)";
-const char * utf8StringThree =
-u8R"(From the Tagelied of Wolfram von Eschenbach (Middle High German):
-Sîne klâwen durh die wolken sint geslagen,
-er stîget ûf mit grôzer kraft,
-ich sih in grâwen tägelîch als er wil tagen,
-den tac, der im geselleschaft
-erwenden wil, dem werden man,
-den ich mit sorgen în verliez.
-ich bringe in hinnen, ob ich kan.
-sîn vil manegiu tugent michz leisten hiez.)";
-const char * utf8StringFour =
-u8R"(Some lines of Odysseus Elytis (Greek):
-Monotonic:
-Τη γλώσσα μου έδωσαν ελληνική
-το σπίτι φτωχικό στις αμμουδιές του Ομήρου.
-Μονάχη έγνοια η γλώσσα μου στις αμμουδιές του Ομήρου.
-από το Άξιον Εστί
-του Οδυσσέα Ελύτη)";
-const char * utf8StringFive =
-u8R"(Polytonic:
-Τὴ γλῶσσα μοῦ ἔδωσαν ἑλληνικὴ
-τὸ σπίτι φτωχικὸ στὶς ἀμμουδιὲς τοῦ Ὁμήρου.
-Μονάχη ἔγνοια ἡ γλῶσσα μου στὶς ἀμμουδιὲς τοῦ Ὁμήρου.
-ἀπὸ τὸ Ἄξιον ἐστί
-τοῦ Ὀδυσσέα Ἐλύτη)";
-const char * utf8StringSix =
-u8R"(The first stanza of Pushkin's Bronze Horseman (Russian):
-На берегу пустынных волн
-Стоял он, дум великих полн,
-И вдаль глядел. Пред ним широко
-Река неслася; бедный чёлн
-По ней стремился одиноко.
-По мшистым, топким берегам
-Чернели избы здесь и там,
-Приют убогого чухонца;
-И лес, неведомый лучам
-В тумане спрятанного солнца,
-Кругом шумел.)";
-const char * utf8StringSeven =
-u8R"(Šota Rustaveli's Veṗxis Ṭq̇aosani, ̣︡Th, The Knight in the Tiger's Skin (Georgian):
-ვეპხის ტყაოსანი შოთა რუსთაველი
-ღმერთსი შემვედრე, ნუთუ კვლა დამხსნას სოფლისა შრომასა, ცეცხლს, წყალსა და მიწასა, ჰაერთა თანა მრომასა; მომცნეს ფრთენი და აღვფრინდე, მივჰხვდე მას ჩემსა ნდომასა, დღისით და ღამით ვჰხედვიდე მზისა ელვათა კრთომაასა.)";
-const char * utf8StringEight =
-u8R"(Tamil poetry of Subramaniya Bharathiyar: சுப்ரமணிய பாரதியார் (1882-1921):
-யாமறிந்த மொழிகளிலே தமிழ்மொழி போல் இனிதாவது எங்கும் காணோம்,
-பாமரராய் விலங்குகளாய், உலகனைத்தும் இகழ்ச்சிசொலப் பான்மை கெட்டு,
-நாமமது தமிழரெனக் கொண்டு இங்கு வாழ்ந்திடுதல் நன்றோ? சொல்லீர்!
-தேமதுரத் தமிழோசை உலகமெலாம் பரவும்வகை செய்தல் வேண்டும்.)";
-const char * utf8StringNine =
-u8R"(Kannada poetry by Kuvempu — ಬಾ ಇಲ್ಲಿ ಸಂಭವಿಸು
-ಬಾ ಇಲ್ಲಿ ಸಂಭವಿಸು ಇಂದೆನ್ನ ಹೃದಯದಲಿ
-ನಿತ್ಯವೂ ಅವತರಿಪ ಸತ್ಯಾವತಾರ
-ಮಣ್ಣಾಗಿ ಮರವಾಗಿ ಮಿಗವಾಗಿ ಕಗವಾಗೀ...
-ಮಣ್ಣಾಗಿ ಮರವಾಗಿ ಮಿಗವಾಗಿ ಕಗವಾಗಿ
-ಭವ ಭವದಿ ಭತಿಸಿಹೇ ಭವತಿ ದೂರ
-ನಿತ್ಯವೂ ಅವತರಿಪ ಸತ್ಯಾವತಾರ || ಬಾ ಇಲ್ಲಿ ||)";
-
-const char * AllUTF8Strings[] =
-{
-		utf8StringOne
-	,	utf8StringTwo
-	,	utf8StringThree
-	,	utf8StringFour
-	,	utf8StringFive
-	,	utf8StringSix
-	,	utf8StringSeven
-	,	utf8StringEight
-	,	utf8StringNine
-};
-
 // Whilst channel IDs are plain ints internally, enums make channel intent a little more obvious. They are meaningless within the scope of this test program, just examples of possible use.
 
 namespace ChannelEnums
@@ -122,6 +41,8 @@ namespace ChannelEnums
 			DEFAULT = 0
 			, USER_INTERFACE
 			, NETWORK_LAYER
+			, METRICS
+			, RATE_LIMITED
 			// etc...
 			, INVALID_CHANNEL = streams::kMaxOutputChannels		// beyond the end of the array
 	};
@@ -129,6 +50,9 @@ namespace ChannelEnums
 
 using namespace ChannelEnums;
 
+// network layer lines below priority 2 are compiled out of this test program
+STREAM_CHANNEL_COMPILED_FILTER( NETWORK_LAYER, 2 )
+
 void CleanupFiles()
 {
 #if defined( _MSC_VER )
@@ -315,10 +239,22 @@ TEST( SelfTests, CheckUTF8Validator )
 	EXPECT_EQ( allPassed, true );
 }
 
+#if defined( _MSC_VER )
+// metrics keep the totals of destroyed channels, so use the Channel IDs of the cleanup tests before they take a memory checkpoint
+void WarmUpChannelTotals()
+{
+	OutputStream< char, OutputStdOut_t > output;
+	StreamList< char > connector{ &output };
+	OutputChannel< char > channelZero( 0, connector, false );
+	OutputChannel< char > channelOne( 1, connector, false );
+}
+#endif // #if defined( _MSC_VER )
+
 TEST( InitAndCleanupTests, CheckStreamCleanup_Single )
 {
 #if defined( _MSC_VER )
 	_CrtMemState entryState, exitState, diffState;
+	WarmUpChannelTotals();
 	_CrtMemCheckpoint( &entryState );
 #endif // #if defined( _MSC_VER )
 	{
@@ -338,6 +274,7 @@ TEST( InitAndCleanupTests, CheckChannelCleanup_Single )
 #if defined( _DEBUG )
 	_CrtMemState entryState, exitState, diffState;
 #endif
+	WarmUpChannelTotals();
 	_CrtMemCheckpoint( &entryState );
 #endif // #if defined( _MSC_VER )
 	{
@@ -358,6 +295,7 @@ TEST( InitAndCleanupTests, CheckMany )
 {
 #if defined( _MSC_VER )
 	_CrtMemState entryState, exitState, diffState;
+	WarmUpChannelTotals();
 	_CrtMemCheckpoint( &entryState );
 #endif // #if defined( _MSC_VER )
 	{
@@ -657,6 +595,78 @@ TEST_F( UTFChannelFiles, CheckUTF16ToUTF8Conversion )
 
 #endif // #if defined ( _MSC_VER )
 
+// Check that a UTF32 stream writing through the transcoding file target produces exactly the UTF8 bytes of the source text
+TEST_F( TestUsingFiles, CheckUTF32FileTranscodesToUTF8 )
+{
+	std::string reference;
+	{
+		StreamFileUTF8< char32_t > stream32( kUTF8TranscodedFilename );
+		std::vector< char32_t > buffer;
+		for ( auto * i : AllUTF8Strings )
+		{
+			// a UTF8 string never has more characters than bytes
+			buffer.assign( strings::GetUTF8StringLengthInBytes( i ) + 1, 0 );
+			strings::UTF8ToUTF32( i, buffer.data() );
+			stream32 << buffer.data() << endl;
+			reference += i;
+			reference += '\n';
+		}
+	}
+
+	std::ifstream inFile( kUTF8TranscodedFilename, std::ios::binary );
+	std::string written( ( std::istreambuf_iterator< char >( inFile ) ), std::istreambuf_iterator< char >() );
+	EXPECT_EQ( written == reference, true );
+}
+
+// Check that a UTF16 stream writing through the transcoding file target combines surrogate pairs, encodes unpaired surrogates as they are,
+// and leaves the four character ASCII path for a quad holding a non-ASCII unit
+TEST_F( TestUsingFiles, CheckUTF16FileTranscodesToUTF8 )
+{
+	// "abc" then U+00E9 in the first quad, "defg" as a whole ASCII quad, U+1F600 as a pair, then a lone high and a lone low surrogate
+	std::u16string const text = { u'a', u'b', u'c', 0x00E9, u'd', u'e', u'f', u'g', 0xD83D, 0xDE00, u'x', 0xD800, u'y', 0xDC00, u'z' };
+	{
+		StreamFileUTF8< char16_t > stream16( kUTF8TranscodedFilename );
+		stream16 << text.c_str() << endl;
+	}
+	std::string const reference = "abc\xC3\xA9" "defg" "\xF0\x9F\x98\x80" "x\xED\xA0\x80" "y\xED\xB0\x80" "z\n";
+
+	std::ifstream inFile( kUTF8TranscodedFilename, std::ios::binary );
+	std::string written( ( std::istreambuf_iterator< char >( inFile ) ), std::istreambuf_iterator< char >() );
+	EXPECT_EQ( written == reference, true );
+}
+
+// Check that repair mode substitutes U+FFFD for each maximal malformed subpart, both when converting and when the encodings match
+TEST( StreamTests, CheckUTFRepairMode )
+{
+	// overlong lead, stray continuation, a surrogate encoding, then a truncated four byte sequence
+	char const * malformed = "a\xC0\xAF" "b\xED\xA0\x80" "c\xF0\x9F\x98" "d";
+
+	StreamMem< char32_t, ConvertingStream_t > stream32;
+	stream32 << RepairUTF( 1 ) << malformed;
+	stream32.flush();
+	std::u32string expected32 = U"a\xFFFD\xFFFD" U"b\xFFFD\xFFFD\xFFFD" U"c\xFFFD" U"d";
+	OutputMem_t< char32_t > & mem32 = stream32.GetOutputTarget();
+	bool allOK = std::u32string( mem32.GetBase(), expected32.length() ) == expected32;
+	allOK &= stream32.GetRepairCount() == 6;
+
+	StreamMem< char, ConvertingStream_t > stream8;
+	stream8 << RepairUTF( 1 ) << malformed;
+	stream8.flush();
+	std::string expected8 = "a\xEF\xBF\xBD\xEF\xBF\xBD" "b\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD" "c\xEF\xBF\xBD" "d";
+	OutputMem_t< char > & mem8 = stream8.GetOutputTarget();
+	allOK &= std::string( mem8.GetBase(), expected8.length() ) == expected8;
+	allOK &= stream8.GetRepairCount() == 6;
+
+	// well formed text is untouched and nothing is counted
+	stream8.ResetRepairCount();
+	mem8.Reset();
+	stream8 << utf8StringNine;
+	stream8.flush();
+	allOK &= 0 == memcmp( mem8.GetBase(), utf8StringNine, strlen( utf8StringNine ) );
+	allOK &= stream8.GetRepairCount() == 0;
+	EXPECT_EQ( allOK, true );
+}
+
 void EmptyThreadFunc( int milliSecondsToWait, StreamList< char >const & connector_ )
 {
 	OutputChannel< char > channel( DEFAULT, connector_, true );
@@ -673,9 +683,6 @@ void EmptyThreadFunc( int milliSecondsToWait, StreamList< char >const & connecto
 // check settings are consistent after delayed thread start and that thread reference count is as expected
 TEST_F( ThreadTester, TestMultithreadInitialisation )
 {
-	StreamSettings * settingsReference = g_AllChannelSettings;
-	uint8_t * flagsReference = g_channelInitFlags;
-
 	SettingsType modifiedEnable = 0;
 	SettingsType modifiedDefaultPriority = 6;
 	SettingsType modifiedFilter = 5;
@@ -700,13 +707,9 @@ TEST_F( ThreadTester, TestMultithreadInitialisation )
 	std::thread workerThreadOne( EmptyThreadFunc, 1000, m_connector );
 	std::thread workerThreadTwo( EmptyThreadFunc, 800, m_connector );
 	workerThreadTwo.join();
-	g_streamsMutex.lock();
-	bool allOK = 3 > g_channelInitFlags[ 0 ];
-	g_streamsMutex.unlock();
+	bool allOK = 3 > GetChannelReferenceCount( DEFAULT );
 	workerThreadOne.join();
-	g_streamsMutex.lock();
-	allOK &= 1 == g_channelInitFlags[ 0 ];
-	g_streamsMutex.unlock();
+	allOK &= 1 == GetChannelReferenceCount( DEFAULT );
 
 	SettingsType retrievedEnable = channel.GetEnable();
 	SettingsType retrievedPriority = channel.GetPriority();
@@ -723,7 +726,6 @@ TEST_F( ThreadTester, TestMultithreadInitialisation )
 TEST( GeneralTests, CheckOutputStamps )
 {
 	bool allOK;
-	uint8_t * flagsReference = g_channelInitFlags;
 
 	StreamStdOut< char > streamOne( nullptr, SystemTimeStamp_t<char>::GetInstance() );
 	StreamList< char > connectorOne{ &streamOne };
@@ -763,7 +765,6 @@ void SameIDThreadFunc( int threadNumber_, int channelNumber_, StreamList< char >
 TEST( GeneralTests, SameChannelIDsDifferentParams )
 {
 	bool allOK = true;
-	uint8_t * flagsReference = g_channelInitFlags;
 
 	// define three different streams
 	StreamStdOut< char > streamOne( nullptr, SystemTimeStamp_t<char>::GetInstance() );
@@ -787,12 +788,7 @@ TEST( GeneralTests, SameChannelIDsDifferentParams )
 		allOK &= false == streamOne.GetIsChannelTarget();
 		allOK &= false == streamTwo.GetIsChannelTarget();
 		// ensure no channels are marked as existing in the channel reference counters
-		g_streamsMutex.lock();
-		for ( auto i : g_channelInitFlags )
-		{
-			allOK &= i == 0;
-		}
-		g_streamsMutex.unlock();
+		allOK &= 0 == GetLiveChannelCount();
 	};
 
 	{
@@ -845,6 +841,1068 @@ TEST( GeneralTests, SameChannelIDsDifferentParams )
 }
 
 
+// Check channel IDs and shared stream counts well beyond the original fixed table sizes of 64 and 32
+TEST( GeneralTests, CheckRegistryGrowth )
+{
+	size_t const numStreams = 200;
+	std::vector< std::unique_ptr< StreamMem< char > > > streams;
+	StreamList< char > connector;
+	for ( size_t i = 0; i < numStreams; ++i )
+	{
+		streams.emplace_back( new StreamMem< char >() );
+		connector.push_back( streams.back().get() );
+	}
+
+	bool allOK = true;
+	{
+		OutputChannel< char > channelOne( 5000, connector, true );
+		OutputChannel< char > channelTwo( 20000, connector, false );
+		channelOne << "one" << endl;
+		channelTwo << "two" << endl;
+		allOK &= 1 == GetChannelReferenceCount( 5000 ) && 1 == GetChannelReferenceCount( 20000 );
+		for ( auto & i : streams )
+		{
+			OutputMem_t< char > & mem = i->GetOutputTarget();
+			allOK &= std::string( mem.GetBase(), mem.GetPtr() ) == "one\ntwo\n";
+			allOK &= i->GetIsChannelTarget();
+		}
+		// a stream destroyed while attached is skipped from then on
+		streams.back().reset();
+		channelOne << "three" << endl;
+	}
+	allOK &= 0 == GetChannelReferenceCount( 5000 ) && 0 == GetLiveChannelCount();
+	for ( size_t i = 0; i < numStreams - 1; ++i )
+		allOK &= false == streams[ i ]->GetIsChannelTarget();
+	EXPECT_EQ( allOK, true );
+}
+
+// Check that channels given an ID outside the registry still write, and leave no entry behind
+TEST( GeneralTests, CheckOutOfRangeChannelIDs )
+{
+	StreamMem< char > stream;
+	bool allOK = true;
+	{
+		OutputChannel< char > negative( -1, { &stream }, true );
+		OutputChannel< char > beyond( kMaxOutputChannels, { &stream }, true );
+		negative << "negative" << endl;
+		beyond << "beyond" << endl;
+		allOK &= false == SetChannelLimits( -1, ChannelLimits{} ) && 0 == GetChannelReferenceCount( kMaxOutputChannels );
+	}
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	allOK &= std::string( mem.GetBase(), mem.GetPtr() ) == "negative\nbeyond\n";
+	allOK &= 0 == GetLiveChannelCount();
+	EXPECT_EQ( allOK, true );
+}
+
+// Check that channels constructed from a ChannelConnector share its streams and recycle their buffers
+TEST( GeneralTests, CheckConnectorChannels )
+{
+	StreamMem< char > stream;
+	bool allOK = true;
+	{
+		ChannelConnector< char > connector( { &stream } );
+		allOK &= stream.GetIsChannelTarget();
+
+		std::streambuf * firstBuffer;
+		{
+			OutputChannel< char > channel( USER_INTERFACE, connector, true );
+			firstBuffer = channel.rdbuf();
+			channel << "first" << endl;
+		}
+		{
+			OutputChannel< char > channel( USER_INTERFACE, connector, true );
+			allOK &= channel.rdbuf() == firstBuffer;
+			channel << "second" << endl;
+		}
+
+		auto taskThread = [ &connector ]()
+		{
+			for ( int i = 0; i < 50; ++i )
+			{
+				OutputChannel< char > channel( USER_INTERFACE, connector, true );
+				channel << "task" << endl;
+			}
+		};
+		std::vector< std::thread > threads;
+		for ( int i = 0; i < 4; ++i )
+			threads.emplace_back( taskThread );
+		for ( auto & i : threads )
+			i.join();
+		allOK &= 0 == GetChannelReferenceCount( USER_INTERFACE ) && 0 == GetLiveChannelCount();
+	}
+	allOK &= false == stream.GetIsChannelTarget();
+
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	std::string written( mem.GetBase(), mem.GetPtr() );
+	allOK &= written.compare( 0, 13, "first\nsecond\n" ) == 0;
+	allOK &= std::count( written.begin(), written.end(), '\n' ) == 202;
+	EXPECT_EQ( allOK, true );
+}
+
+// Check that once a Channel ID and the pool are warm, constructing and destroying pooled channels takes neither registry nor metrics lock
+TEST( GeneralTests, CheckPooledChannelsTakeNoLock )
+{
+	StreamMem< char > stream;
+	bool allOK = true;
+	{
+		ChannelConnector< char > connector( { &stream } );
+		{
+			OutputChannel< char > channel( USER_INTERFACE, connector, true );
+			channel << "warm" << endl;
+		}
+		std::atomic< bool > done{ false };
+		std::unique_lock< std::mutex > streamsLock( streams::g_streamsMutex );
+		std::unique_lock< std::mutex > metricsLock( streams::g_metricsMutex );
+		std::thread worker( [ &connector, &done ]()
+		{
+			for ( int i = 0; i < 100; ++i )
+			{
+				OutputChannel< char > channel( USER_INTERFACE, connector, true );
+				channel << "pooled" << endl;
+			}
+			done = true;
+		} );
+		for ( int i = 0; i < 5000 && !done; ++i )
+			std::this_thread::sleep_for( milliseconds( 1 ) );
+		allOK &= done;
+		metricsLock.unlock();
+		streamsLock.unlock();
+		worker.join();
+	}
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	std::string written( mem.GetBase(), mem.GetPtr() );
+	allOK &= std::count( written.begin(), written.end(), '\n' ) == 101;
+	EXPECT_EQ( allOK, true );
+}
+
+// Check stream and channel counters, both snapshot formats and the periodic dumper
+TEST( GeneralTests, CheckMetrics )
+{
+	auto findChannel = []( MetricsSnapshot const & snapshot_ )
+	{
+		for ( auto & i : snapshot_.channels )
+			if ( i.channelId == METRICS )
+				return i;
+		return MetricsSnapshot::Channel{ METRICS, 0, 0, 0, 0, 0, 0 };
+	};
+	// channel totals outlive their channels so compare against the totals before the test
+	MetricsSnapshot::Channel before = findChannel( GetMetricsSnapshot() );
+
+	StreamMem< char > stream( "metricsStream" );
+	StreamList< char > connector{ &stream };
+	stream << "abc" << endl;
+	stream << Filter( 0 ) << "filtered by the stream" << endl;
+	stream << Filter( ~0 );
+	{
+		OutputChannel< char > channel( METRICS, connector, false );
+		channel << "12345" << endl;
+		channel << Filter( 0 ) << "filtered by the channel" << endl;
+		channel << Filter( ~0 );
+	}
+
+	MetricsSnapshot snapshot = GetMetricsSnapshot();
+	bool allOK = false;
+	for ( auto & i : snapshot.streams )
+	{
+		if ( i.name == "metricsStream" )
+			allOK = i.linesEmitted == 2 && i.linesFiltered == 1 && i.bytes == 10 && i.targetErrors == 0;
+	}
+	MetricsSnapshot::Channel after = findChannel( snapshot );
+	allOK &= after.liveChannels == 0;
+	allOK &= after.linesEmitted - before.linesEmitted == 1;
+	allOK &= after.linesFiltered - before.linesFiltered == 1;
+	allOK &= after.bytes - before.bytes == 6;
+
+	std::ostringstream text;
+	WriteMetrics( text, snapshot );
+	allOK &= text.str().find( "stream metricsStream lines=2 filtered=1 bytes=10 " ) != std::string::npos;
+	std::ostringstream prometheus;
+	WriteMetrics( prometheus, snapshot, MetricsFormat::Prometheus );
+	allOK &= prometheus.str().find( "# TYPE outputstreams_stream_lines_total counter\n" ) != std::string::npos;
+	allOK &= prometheus.str().find( "\noutputstreams_stream_lines_total{stream=\"metricsStream\"} 2\n" ) != std::string::npos;
+	allOK &= prometheus.str().find( "\noutputstreams_channel_bytes_total{channel=\"" + std::to_string( METRICS ) + "\"} " ) != std::string::npos;
+
+	StreamMem< char > dumpStream( "metricsDump" );
+	OutputMem_t< char > & mem = dumpStream.GetOutputTarget();
+	{
+		MetricsDumper<> dumper( METRICS, { &dumpStream }, std::chrono::milliseconds( 0 ) );
+		allOK &= mem.GetPtr() == mem.GetBase();
+		dumper.Tick();
+	}
+	allOK &= std::string( mem.GetBase(), mem.GetPtr() ).find( "stream metricsStream lines=2" ) != std::string::npos;
+	EXPECT_EQ( allOK, true );
+}
+
+// Check a stream's counters lose no increments when several threads add to them at once
+TEST( GeneralTests, CheckSharedMetricCounters )
+{
+	StreamMetrics metrics;
+	std::vector< std::thread > threads;
+	for ( int i = 0; i < 4; ++i )
+		threads.emplace_back( [ &metrics ]() { for ( int j = 0; j < 100000; ++j ) metrics.linesEmitted.Add(); } );
+	for ( auto & i : threads )
+		i.join();
+	EXPECT_EQ( metrics.linesEmitted.Get(), 400000u );
+}
+
+// Check batched channel lines reach the stream as one Output() per batch, intact and in order
+TEST( GeneralTests, CheckChannelBatching )
+{
+	StreamMem< char > stream;
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	auto written = [ &mem ]() { return std::string( mem.GetBase(), mem.GetPtr() ); };
+	bool allOK = true;
+	{
+		ChannelConnector< char > connector( { &stream } );
+		OutputChannel< char > channel( USER_INTERFACE, connector, true );
+		BatchSettings batching;
+		batching.maxLines = 3;
+		channel.SetBatching( batching );
+
+		channel << "one" << endl << "two" << endl;
+		allOK &= written().empty();
+		channel << "three" << endl;
+		allOK &= written() == "one\ntwo\nthree\n" && 1 == stream.m_metrics.linesEmitted.Get();
+
+		channel << "four" << endl;
+		channel.PublishBatch();
+		channel << "five" << endl;
+		allOK &= written() == "one\ntwo\nthree\nfour\n" && 2 == stream.m_metrics.linesEmitted.Get();
+	}
+	// the channel publishes its remaining lines on destruction
+	allOK &= written() == "one\ntwo\nthree\nfour\nfive\n" && 3 == stream.m_metrics.linesEmitted.Get();
+
+	// a batch is due once it reaches maxBytes, counting the line that crosses it
+	mem.Reset();
+	{
+		OutputChannel< char > channel( USER_INTERFACE, { &stream }, true );
+		BatchSettings batching;
+		batching.maxBytes = 10;
+		channel.SetBatching( batching );
+		channel << "1234" << endl;
+		allOK &= written().empty();
+		channel << "5678" << endl;
+		allOK &= written() == "1234\n5678\n";
+	}
+
+	// an aged batch is published as the next line ends, before that line and even though it is filtered
+	mem.Reset();
+	{
+		OutputChannel< char > channel( USER_INTERFACE, { &stream }, true );
+		BatchSettings batching;
+		batching.maxAge = milliseconds( 20 );
+		channel.SetBatching( batching );
+		channel << "young" << endl;
+		allOK &= written().empty();
+		std::this_thread::sleep_for( milliseconds( 30 ) );
+		channel << Filter( 0 ) << "filtered" << endl;
+		allOK &= written() == "young\n";
+		channel << Filter( ~0 ) << "after" << endl;
+		allOK &= written() == "young\n";
+	}
+	allOK &= written() == "young\nafter\n";
+	EXPECT_EQ( allOK, true );
+}
+
+// Check each of the channel's line policy stages on its own, without a channel
+TEST( GeneralTests, CheckLinePolicyStages )
+{
+	bool allOK = true;
+
+	LineBatcher_t< char > batcher;
+	allOK &= !batcher.IsHolding();
+	BatchSettings batching;
+	batching.maxLines = 2;
+	batcher.SetBatching( batching );
+	allOK &= batcher.IsHolding() && !batcher.Add( "one\n", 4 ) && batcher.Add( "two\n", 4 );
+	allOK &= std::string( batcher.GetData(), batcher.GetLength() ) == "one\ntwo\n" && 2 == batcher.GetNumLines();
+	batcher.Clear();
+	batcher.BeginBlock( false );
+	batcher.BeginBlock( true );
+	allOK &= !batcher.IsStamping() && !batcher.Add( "a\n", 2 ) && !batcher.Add( "b\n", 2 ) && !batcher.Add( "c\n", 2 );
+	allOK &= !batcher.EndBlock() && batcher.EndBlock() && batcher.IsStamping() && 3 == batcher.GetNumLines();
+	batcher.Reset();
+	allOK &= !batcher.IsHolding() && 0 == batcher.GetLength();
+
+	BacktraceRing_t< char > ring;
+	allOK &= !ring.IsEnabled() && 0 == ring.Resize( 2 ) && ring.IsEnabled();
+	allOK &= !ring.Keep( "1", 1 ) && !ring.Keep( "2", 1 ) && ring.Keep( "3", 1 ) && 2 == ring.GetCount();
+	std::string kept;
+	ring.Drain( [ &kept ]( char const * line_, size_t length_ ) { kept.append( line_, length_ ); } );
+	allOK &= kept == "23" && 0 == ring.GetCount();
+	ring.Keep( "4", 1 );
+	allOK &= 1 == ring.Discard() && 0 == ring.Resize( 0 ) && !ring.IsEnabled();
+
+	LineDeduplicator dedup;
+	dedup.SetWindow( std::chrono::milliseconds( 1000 ) );
+	uint64_t repeats = 0;
+	allOK &= !dedup.IsRepeat( "x", 1, 0, repeats ) && dedup.IsRepeat( "x", 1, 1, repeats ) && dedup.IsRepeat( "x", 1, 2, repeats );
+	allOK &= !dedup.IsRepeat( "y", 1, 3, repeats ) && 2 == repeats && 0 == dedup.TakeRepeats();
+
+	ChannelLimiter limiter;
+	ChannelLimits limits;
+	limits.sampleEvery = 3;
+	limiter.Configure( limits );
+	int admitted = 0;
+	for ( int i = 0; i < 9; ++i )
+		admitted += limiter.AdmitLine( 0 ) ? 1 : 0;
+	allOK &= 3 == admitted && limiter.IsLineLimited();
+	EXPECT_EQ( allOK, true );
+}
+
+// Check a block's lines reach the stream together, after lines other channels wrote meanwhile, with or without stamps
+TEST( GeneralTests, CheckChannelBlocks )
+{
+	class FixedStamp : public OutputStamp
+	{
+	public:
+		virtual int GetMaxLength() const override { return 2; }
+		virtual int GetLength() override { return 2; }
+		virtual int WriteStamp( void * ptr_ = nullptr ) override
+		{
+			if ( ptr_ )
+				memcpy( ptr_, "> ", 2 );
+			return 2;
+		}
+	};
+	FixedStamp stamp;
+	StreamMem< char > stream;
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	auto written = [ &mem ]() { return std::string( mem.GetBase(), mem.GetPtr() ); };
+	bool allOK = true;
+	{
+		ChannelConnector< char > connector( { &stream } );
+		OutputChannel< char > channel( USER_INTERFACE, connector, true, stamp );
+		OutputChannel< char > other( NETWORK_LAYER, connector, true );
+		{
+			OutputChannel< char >::Block block( channel );
+			channel << "request" << endl << "header" << endl;
+			other << "other" << endl;
+			allOK &= written() == "other\n";
+		}
+		allOK &= written() == "other\n> request\n> header\n" && 2 == stream.m_metrics.linesEmitted.Get();
+		{
+			OutputChannel< char >::Block block( channel, false );
+			channel << "dump" << endl;
+			OutputChannel< char >::Block inner( channel );
+			channel << "nested" << endl;
+		}
+		allOK &= written() == "other\n> request\n> header\ndump\nnested\n" && 3 == stream.m_metrics.linesEmitted.Get();
+	}
+	EXPECT_EQ( allOK, true );
+}
+
+// Check filtered lines kept for a backtrace are published, the latest of them only, just before a line at the trigger priority
+TEST( GeneralTests, CheckChannelBacktrace )
+{
+	StreamMem< char > stream;
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	auto written = [ &mem ]() { return std::string( mem.GetBase(), mem.GetPtr() ); };
+	bool allOK = true;
+	{
+		ChannelConnector< char > connector( { &stream } );
+		OutputChannel< char > channel( USER_INTERFACE, connector, true );
+		ChannelMetrics & metrics = channel.GetChannelMetrics();
+		uint64_t filteredBefore = metrics.linesFiltered.Get();
+		channel.SetFilter( kPriorityDefault );
+		BacktraceSettings backtrace;
+		backtrace.numLines = 3;
+		channel.SetBacktrace( backtrace );
+
+		for ( int i = 1; i <= 5; ++i )
+			channel << Priority( 2 ) << "detail " << i << endl;
+		channel << "routine" << endl;
+		allOK &= written() == "routine\n";
+		channel << Priority( 0 ) << "error" << endl;
+		allOK &= written() == "routine\ndetail 3\ndetail 4\ndetail 5\nerror\n";
+		channel << Priority( 2 ) << "detail 6" << endl;
+		channel << Priority( 0 ) << "error" << endl;
+		allOK &= written() == "routine\ndetail 3\ndetail 4\ndetail 5\nerror\ndetail 6\nerror\n";
+		channel << Priority( 2 ) << "detail 7" << endl;
+		allOK &= 2 == metrics.linesFiltered.Get() - filteredBefore;
+		channel.SetFilter( kDefaultFilter );
+	}
+	// the line kept when the channel ended never saw a trigger
+	allOK &= written() == "routine\ndetail 3\ndetail 4\ndetail 5\nerror\ndetail 6\nerror\n";
+	EXPECT_EQ( allOK, true );
+}
+
+// Check lines from many producers sharing a combining stream all arrive intact
+TEST( GeneralTests, CheckCombiningStream )
+{
+	StreamMem< char > stream;
+	stream.SetCombining( true );
+	{
+		ChannelConnector< char > connector( { &stream } );
+		auto taskThread = [ &connector ]( int id_ )
+		{
+			OutputChannel< char > channel( USER_INTERFACE, connector, true );
+			for ( int i = 0; i < 500; ++i )
+				channel << "producer " << id_ << " line " << i << endl;
+		};
+		std::vector< std::thread > threads;
+		for ( int i = 0; i < 4; ++i )
+			threads.emplace_back( taskThread, i );
+		for ( auto & i : threads )
+			i.join();
+	}
+
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	std::istringstream written( std::string( mem.GetBase(), mem.GetPtr() ) );
+	std::string line;
+	int nextLine[ 4 ] = { 0, 0, 0, 0 };
+	bool allOK = true;
+	while ( std::getline( written, line ) )
+	{
+		int id, index;
+		allOK &= 2 == std::sscanf( line.c_str(), "producer %d line %d", &id, &index ) && id >= 0 && id < 4 && index == nextLine[ id ]++;
+	}
+	allOK &= nextLine[ 0 ] == 500 && nextLine[ 1 ] == 500 && nextLine[ 2 ] == 500 && nextLine[ 3 ] == 500;
+	allOK &= stream.m_metrics.linesEmitted.Get() <= 2000;
+	EXPECT_EQ( allOK, true );
+}
+
+// Check sampling and line rate limits drop lines however they are written and ended, without touching the channel's state, and that
+// dropped lines are summarised once the summary period has passed. The limits run on a test clock, so the outcome is exact.
+namespace
+{
+	std::atomic< uint64_t > g_limitsTestNanoseconds{ 0 };
+	uint64_t GetLimitsTestNanoseconds() { return g_limitsTestNanoseconds.load(); }
+}
+
+TEST( GeneralTests, CheckChannelLimits )
+{
+	StreamMem< char > stream;
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	auto written = [ &mem ]() { return std::string( mem.GetBase(), mem.GetPtr() ); };
+	bool allOK = true;
+	{
+		StreamList< char > connector{ &stream };
+		OutputChannel< char > channel( RATE_LIMITED, connector, false );
+
+		ChannelLimits limits;
+		limits.clock = GetLimitsTestNanoseconds;
+		limits.sampleEvery = 4;
+		channel.SetLimits( limits );
+		for ( int i = 0; i < 8; ++i )
+		{
+			channel << "s" << i;
+			if ( i % 2 )
+				channel << endl;
+			else
+				channel << std::endl;
+			allOK &= channel.good();
+		}
+		allOK &= written() == "s0\ns4\n";
+
+		// lines ended by a flush, and lines written a character at a time
+		mem.Reset();
+		limits.sampleEvery = 2;
+		channel.SetLimits( limits );
+		for ( int i = 0; i < 6; ++i )
+		{
+			channel << "line" << i << '\n';
+			channel.flush();
+		}
+		for ( int i = 0; i < 4; ++i )
+			channel << u"wide" << endl;
+		allOK &= written() == "line0\nline2\nline4\nwide\nwide\n" && channel.good();
+
+		mem.Reset();
+		limits.sampleEvery = 0;
+		limits.linesPerSecond = 5;
+		limits.summaryPeriod = std::chrono::milliseconds( 100 );
+		channel.SetLimits( limits );
+		for ( int i = 0; i < 20; ++i )
+			channel << "r" << i << endl;
+		allOK &= written() == "r0\nr1\nr2\nr3\nr4\n" && channel.good();
+
+		// the next line to end after the summary period publishes the summary first, whether or not it is admitted itself. After 150ms the
+		// line is still over the rate and counts itself, after 250ms it is admitted.
+		std::string const summary = "channel " + std::to_string( RATE_LIMITED ) + ": ";
+		mem.Reset();
+		g_limitsTestNanoseconds = 150000000;
+		channel << "over" << endl;
+		allOK &= written() == summary + "16 lines suppressed in last 1s\n";
+		mem.Reset();
+		g_limitsTestNanoseconds = 400000000;
+		channel << "next" << endl;
+		allOK &= written() == "next\n";
+
+		// lines dropped by sampling are reported apart from those over the rate
+		mem.Reset();
+		limits.sampleEvery = 2;
+		limits.linesPerSecond = 0;
+		channel.SetLimits( limits );
+		for ( int i = 0; i < 6; ++i )
+			channel << "t" << i << endl;
+		g_limitsTestNanoseconds = 600000000;
+		channel << "t6" << endl;
+		allOK &= written() == "t0\nt2\nt4\n" + summary + "0 lines suppressed, 3 sampled out in last 1s\nt6\n";
+	}
+	SetChannelLimits( RATE_LIMITED, ChannelLimits() );
+	EXPECT_EQ( allOK, true );
+}
+
+// Check runs of identical lines collapse into a repeat count, on streams and on channels, ignoring stamps
+TEST( GeneralTests, CheckDeduplication )
+{
+	auto writeLines = []( BasicStream< char > & stream_ )
+	{
+		stream_ << "alpha" << endl;
+		for ( int i = 0; i < 3; ++i )
+			stream_ << "beta" << endl;
+		stream_ << "alpha" << endl;
+		stream_ << "alpha" << endl;
+	};
+	bool allOK = true;
+
+	// a line stamp differs on every line and must not defeat deduplication
+	StreamMem< char > stream( nullptr, LineStamp_t< char >::GetInstance() );
+	stream.SetDeduplication( std::chrono::milliseconds( 10000 ) );
+	writeLines( stream );
+	stream.SetDeduplication( std::chrono::milliseconds( 0 ) );
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	std::string written( mem.GetBase(), mem.GetPtr() );
+	allOK &= std::count( written.begin(), written.end(), '\n' ) == 5;
+	// repeat reports are stamped like any other line
+	size_t const afterBeta = written.find( "beta\n" ) + 5;
+	allOK &= afterBeta > 5 && written.find( " repeated 2 times\n", afterBeta ) == written.find( ' ', afterBeta );
+	allOK &= written.size() > 17 && written.compare( written.size() - 17, 17, " repeated 1 time\n" ) == 0;
+	for ( size_t i = 0; i < written.size(); i = written.find( '\n', i ) + 1 )
+		allOK &= 0 != isdigit( written[ i ] );
+
+	StreamMem< char > target;
+	{
+		StreamList< char > connector{ &target };
+		OutputChannel< char > channel( USER_INTERFACE, connector, true );
+		channel.SetDeduplication( std::chrono::milliseconds( 10000 ) );
+		writeLines( channel );
+	}
+	OutputMem_t< char > & targetMem = target.GetOutputTarget();
+	allOK &= std::string( targetMem.GetBase(), targetMem.GetPtr() ) == "alpha\nbeta\nrepeated 2 times\nalpha\nrepeated 1 time\n";
+
+	// a run in progress is reported on demand
+	StreamMem< char > flushed;
+	flushed.SetDeduplication( std::chrono::milliseconds( 10000 ) );
+	{
+		StreamList< char > connector{ &target };
+		OutputChannel< char > channel( USER_INTERFACE, connector, true );
+		channel.SetDeduplication( std::chrono::milliseconds( 10000 ) );
+		targetMem.Reset();
+		for ( int i = 0; i < 3; ++i )
+		{
+			channel << "gamma" << endl;
+			flushed << "gamma" << endl;
+		}
+		channel.FlushRepeats();
+		flushed.FlushRepeats();
+		allOK &= std::string( targetMem.GetBase(), targetMem.GetPtr() ) == "gamma\nrepeated 2 times\n";
+	}
+	OutputMem_t< char > & flushedMem = flushed.GetOutputTarget();
+	allOK &= std::string( flushedMem.GetBase(), flushedMem.GetPtr() ) == "gamma\nrepeated 2 times\n";
+	EXPECT_EQ( allOK, true );
+}
+
+// Check STREAM_LINE strips lines below a channel's compiled filter without evaluating them and keeps the rest at their priority
+TEST( GeneralTests, CheckCompiledFilter )
+{
+	static_assert( IsCompiledOut< NETWORK_LAYER, 3 >() && !IsCompiledOut< NETWORK_LAYER, 2 >() && !IsCompiledOut< DEFAULT, 3 >(), "compiled filters" );
+
+	StreamMem< char > stream;
+	int evaluated = 0;
+	auto argument = [ &evaluated ]() { return ++evaluated; };
+	{
+		StreamList< char > connector{ &stream };
+		OutputChannel< char > channel( NETWORK_LAYER, connector, true );
+		channel << Filter( 2 );
+		STREAM_LINE( channel, NETWORK_LAYER, 3 ) << "stripped " << argument() << endl;
+		STREAM_LINE( channel, NETWORK_LAYER, 2 ) << "kept " << argument() << endl;
+		// the runtime filter still applies to lines that are compiled in
+		STREAM_LINE( channel, DEFAULT, 3 ) << "filtered " << argument() << endl;
+		channel << Filter( ~0 );
+	}
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	EXPECT_EQ( evaluated == 2 && std::string( mem.GetBase(), mem.GetPtr() ) == "kept 1\n", true );
+}
+
+// Check call sites are listed before they run, skip their arguments while disabled and can be switched by pattern
+TEST( GeneralTests, CheckCallSites )
+{
+	StreamMem< char > stream;
+	int evaluated = 0;
+	auto argument = [ &evaluated ]() { return ++evaluated; };
+	int const siteLine = __LINE__ + 1;
+	auto writeLine = [ & ]() { STREAM_SITE_OFF( stream ) << "deep " << argument() << endl; };
+
+	std::string const pattern = "StreamTest.cpp:" + std::to_string( siteLine );
+	bool allOK = false;
+	for ( auto * i : GetCallSites() )
+		if ( i->line == siteLine && std::strstr( i->file, "StreamTest.cpp" ) )
+			allOK = !i->IsEnabled();
+
+	writeLine();
+	allOK &= 0 == evaluated;
+	allOK &= 1 == EnableCallSites( pattern.c_str(), true );
+	writeLine();
+	allOK &= 1 == EnableCallSites( ( "*" + pattern ).c_str(), false );
+	writeLine();
+	allOK &= 0 == EnableCallSites( "*StreamTest.cpp:0", true );
+
+	// a site unregistered, as a shared library's are when it unloads, is no longer listed or matched
+	CallSite unloaded{ "Unloaded.cpp", 7, { 0 }, nullptr };
+	RegisterCallSite( &unloaded );
+	allOK &= 1 == EnableCallSites( "Unloaded.cpp:7", true ) && unloaded.IsEnabled();
+	UnregisterCallSite( &unloaded );
+	allOK &= 0 == EnableCallSites( "Unloaded.cpp:7", true );
+	for ( auto * i : GetCallSites() )
+		allOK &= i != &unloaded;
+
+	OutputMem_t< char > & mem = stream.GetOutputTarget();
+	EXPECT_EQ( allOK && 1 == evaluated && std::string( mem.GetBase(), mem.GetPtr() ) == "deep 1\n", true );
+}
+
+#if defined( __linux )
+// Check a second mapping of the control block, as streamctl uses, changes the settings of channels and streams in this process, whether
+// they existed before the block was opened or not, and that closing the block moves the settings back
+TEST( GeneralTests, CheckControlBlock )
+{
+	std::string const name = "/streamtest_" + std::to_string( getpid() );
+	auto findStream = []( ControlBlock * block_, std::string const & name_ ) -> ControlBlock::Stream *
+	{
+		for ( auto & i : block_->streams )
+			if ( ControlBlock::Stream::kAttached == i.state.load() && std::string( i.name ) == name_ )
+				return &i;
+		return nullptr;
+	};
+	StreamMem< char > earlyStream;
+	StreamMem< char > named( "controlled" );
+	bool allOK = true;
+	{
+		// channels and streams created before the block is opened are moved into it, unnamed streams by their generated name
+		StreamList< char > connector{ &earlyStream };
+		OutputChannel< char > early( METRICS, connector, true );
+		ASSERT_EQ( OpenControlBlock( name.c_str() ), true );
+		ControlBlock * block = MapControlBlock( name.c_str() );
+		ASSERT_NE( block, nullptr );
+
+		StreamStdOut< char > standardOut;
+		allOK &= 1 == block->channels[ METRICS ].attached.load() && 0 == block->channels[ RATE_LIMITED ].attached.load();
+		allOK &= nullptr != findStream( block, earlyStream.GetMetrics().name ) && nullptr != findStream( block, "stdout" );
+		block->channels[ METRICS ].settings.SetFilter( 0 );
+		early << "hidden" << endl;
+		block->channels[ METRICS ].settings.SetFilter( ~0 );
+		early << "shown" << endl;
+		block->channels[ METRICS ].settings.SetFilter( 7 );
+
+		ControlBlock::Stream * controlled = findStream( block, "controlled" );
+		allOK &= nullptr != controlled;
+		if ( controlled )
+			controlled->settings.Enable( 0 );
+		named << "disabled" << endl;
+		allOK &= 0 == named.GetOutputTarget().GetPtr() - named.GetOutputTarget().GetBase();
+		munmap( block, sizeof( ControlBlock ) );
+	}
+
+	// a change made in the block survives the ID falling idle, the next channel using it doesn't reset it
+	{
+		OutputChannel< char > next( METRICS, { &earlyStream }, true );
+		allOK &= 7 == next.GetFilter();
+		next.SetFilter( ~0 );
+	}
+
+	// an ID beyond the block is looked up once, and later channels using it take no lock
+	{
+		OutputChannel< char > first( 2000, { &earlyStream }, true );
+	}
+	{
+		ChannelConnector< char > connector( { &earlyStream } );
+		std::atomic< bool > done{ false };
+		std::unique_lock< std::mutex > streamsLock( streams::g_streamsMutex );
+		std::thread channelWorker( [ &connector, &done ]()
+		{
+			OutputChannel< char > later( 2000, connector, true );
+			done = true;
+		} );
+		for ( int i = 0; i < 5000 && !done; ++i )
+			std::this_thread::sleep_for( milliseconds( 1 ) );
+		allOK &= done;
+		streamsLock.unlock();
+		channelWorker.join();
+	}
+
+	CloseControlBlock();
+	allOK &= nullptr == GetControlBlock() && nullptr == MapControlBlock( name.c_str() );
+	allOK &= 0 == named.GetEnable();
+	named.Enable( 1 );
+	EXPECT_EQ( allOK, true );
+	OutputMem_t< char > & mem = earlyStream.GetOutputTarget();
+	EXPECT_EQ( std::string( mem.GetBase(), mem.GetPtr() ), "shown\n" );
+}
+#endif // #if defined( __linux )
+
+// Check a rotating file moves to a new segment before a write would overflow it, expires old segments, leaves each at its real size and
+// removes the prepared segment it never used
+TEST( GeneralTests, CheckRotatingFile )
+{
+	auto readFile = []( std::string const & filename_ )
+	{
+		std::ifstream inFile( filename_, std::ios::binary );
+		return std::string( std::istreambuf_iterator< char >( inFile ), std::istreambuf_iterator< char >() );
+	};
+	std::string filenames[ 4 ];
+	bool allOK = true;
+	{
+		StreamRotatingFile< char > stream( "rotating.%N.test.txt" );
+		auto & target = stream.GetOutputTarget();
+		RotationSettings rotation;
+		rotation.maxBytes = 25;
+		rotation.keep = 2;
+		target.SetRotation( rotation );
+		for ( int i = 0; i < 4; ++i )
+			filenames[ i ] = target.GetFilename( i );
+		for ( int i = 0; i < 6; ++i )
+			stream << "line " << i << "..." << endl;
+		allOK &= target.GetCurrentFilename() == filenames[ 2 ];
+	}
+	allOK &= readFile( filenames[ 0 ] ).empty() && !std::ifstream( filenames[ 0 ] ).good();
+	allOK &= readFile( filenames[ 1 ] ) == "line 2...\nline 3...\n";
+	allOK &= readFile( filenames[ 2 ] ) == "line 4...\nline 5...\n";
+	allOK &= !std::ifstream( filenames[ 3 ] ).good();
+	for ( auto & i : filenames )
+		std::remove( i.c_str() );
+	EXPECT_EQ( allOK, true );
+}
+
+#if defined( __linux )
+// Check output through a mapped file crosses chunk boundaries intact and the file is cut to its real size on close
+TEST( GeneralTests, CheckMmapFile )
+{
+	auto constexpr kFilename = "mmap.test.txt";
+	std::string expected;
+	{
+		StreamMmapFile< char > stream( kFilename );
+		MmapSettings mapping;
+		mapping.chunkBytes = 1;		// a page at a time
+		mapping.sync = MmapSettings::Sync::Async;
+		stream.GetOutputTarget().SetMapping( mapping );
+		for ( int i = 0; i < 1000; ++i )
+		{
+			stream << "mapped line " << i << endl;
+			expected += "mapped line " + std::to_string( i ) + "\n";
+		}
+		EXPECT_EQ( stream.m_metrics.targetErrors.Get(), 0u );
+	}
+	std::ifstream inFile( kFilename, std::ios::binary );
+	std::string written( ( std::istreambuf_iterator< char >( inFile ) ), std::istreambuf_iterator< char >() );
+	inFile.close();
+	std::remove( kFilename );
+	EXPECT_EQ( written == expected && expected.size() > 8192, true );
+}
+
+// Check lines queued to an io_uring file, or written directly where io_uring is unavailable, all arrive in order once flushed
+TEST( GeneralTests, CheckUringFile )
+{
+	auto constexpr kFilename = "uring.test.txt";
+	std::string expected;
+	{
+		StreamUringFile< char > stream( kFilename );
+		std::string const padding( 1000, '.' );
+		for ( int i = 0; i < 1000; ++i )
+		{
+			stream << "queued line " << i << padding << endl;
+			expected += "queued line " + std::to_string( i ) + padding + "\n";
+		}
+		stream.GetOutputTarget().Flush();
+		EXPECT_EQ( stream.m_metrics.targetErrors.Get(), 0u );
+	}
+	std::ifstream inFile( kFilename, std::ios::binary );
+	std::string written( ( std::istreambuf_iterator< char >( inFile ) ), std::istreambuf_iterator< char >() );
+	inFile.close();
+	std::remove( kFilename );
+	EXPECT_EQ( written == expected, true );
+}
+#endif // #if defined( __linux )
+
+// Check vectored output writes every segment in order, beyond IOV_MAX segments, and that a combining file stream uses it
+TEST( GeneralTests, CheckVectoredOutput )
+{
+	auto constexpr kFilename = "vectored.test.txt";
+	auto readFile = [ kFilename ]()
+	{
+		std::ifstream inFile( kFilename, std::ios::binary );
+		return std::string( std::istreambuf_iterator< char >( inFile ), std::istreambuf_iterator< char >() );
+	};
+	std::vector< std::string > text;
+	std::string expected;
+	for ( int i = 0; i < 2000; ++i )
+	{
+		text.push_back( "segment " + std::to_string( i ) + "\n" );
+		expected += text.back();
+	}
+	std::vector< OutputSegment_t< char > > segments;
+	for ( auto & i : text )
+		segments.push_back( OutputSegment_t< char >{ i.data(), static_cast< uint32_t >( i.size() ), static_cast< uint32_t >( i.size() ) } );
+	{
+		OutputFile_t< char > target( kFilename );
+		target.OutputV( segments.data(), segments.size() );
+		EXPECT_EQ( target.GetErrorCount(), 0u );
+	}
+	bool allOK = readFile() == expected;
+
+	{
+		StreamFile< char > stream( kFilename );
+		stream.SetCombining( true );
+		{
+			ChannelConnector< char > connector( { &stream } );
+			OutputChannel< char > channel( USER_INTERFACE, connector, true );
+			channel << "combined one" << endl << "combined two" << endl;
+		}
+		allOK &= 2 == stream.m_metrics.linesEmitted.Get();
+	}
+	allOK &= readFile() == "combined one\ncombined two\n";
+	std::remove( kFilename );
+	EXPECT_EQ( allOK, true );
+}
+
+// Check high priority lines, including those from channels, and the byte threshold sync the file, and that writers waiting together share one sync
+TEST( GeneralTests, CheckDurability )
+{
+	auto constexpr kFilename = "durable.test.txt";
+	bool allOK = true;
+	{
+		StreamFile< char > stream( kFilename );
+		auto commit = AcquireGroupCommit( kFilename );
+		DurabilitySettings durability;
+		durability.priority = kPriorityMax;
+		stream.GetOutputTarget().SetDurability( durability );
+		stream << "routine" << endl;
+		allOK &= 0 == commit->GetSyncCount();
+		stream << Priority( 0 ) << "important" << endl;
+		allOK &= 1 == commit->GetSyncCount();
+		stream << "routine" << endl;
+		allOK &= 1 == commit->GetSyncCount();
+
+		durability.bytes = 20;
+		stream.GetOutputTarget().SetDurability( durability );
+		stream << "123456789" << endl << "123456789" << endl;
+		allOK &= 2 == commit->GetSyncCount();
+
+		// a sync started after several writes covers them all
+		uint64_t tickets[ 4 ];
+		for ( auto & i : tickets )
+			i = commit->Add( 10 );
+		for ( auto i : tickets )
+			allOK &= commit->Commit( i );
+		allOK &= 3 == commit->GetSyncCount();
+
+		// lines from a channel are committed at the channel's priority, published alone, in a block or through combining slots
+		durability.bytes = 0;
+		stream.GetOutputTarget().SetDurability( durability );
+		{
+			OutputChannel< char > channel( 3000, { &stream }, false );
+			channel << "routine" << endl;
+			allOK &= 3 == commit->GetSyncCount();
+			channel << Priority( 0 ) << "important" << endl;
+			allOK &= 4 == commit->GetSyncCount();
+		}
+		stream.SetCombining( true );
+		{
+			OutputChannel< char > channel( 3000, { &stream }, true );
+			channel << "routine" << endl;
+			allOK &= 4 == commit->GetSyncCount();
+			{
+				OutputChannel< char >::Block block( channel );
+				channel << Priority( 0 ) << "important" << endl << "routine" << endl;
+				allOK &= 4 == commit->GetSyncCount();
+			}
+			allOK &= 5 == commit->GetSyncCount();
+			channel << "routine" << endl;
+			allOK &= 5 == commit->GetSyncCount();
+		}
+		allOK &= 0 == stream.m_metrics.targetErrors.Get();
+	}
+	std::remove( kFilename );
+	EXPECT_EQ( allOK, true );
+}
+
+// Check the flight recorder keeps only its latest records intact, including records spanning slots and from concurrent producers, and dumps on a
+// trigger written to its stream or published by a channel
+TEST( GeneralTests, CheckFlightRecorder )
+{
+	auto constexpr kFilename = "recorder.test.txt";
+	auto readFile = []( std::string const & filename_ )
+	{
+		std::ifstream inFile( filename_, std::ios::binary );
+		return std::string( std::istreambuf_iterator< char >( inFile ), std::istreambuf_iterator< char >() );
+	};
+	bool allOK = true;
+	{
+		auto recorder = AcquireFlightRecorder( "recorder.test", 16 * FlightRecorder::kPayloadBytes );
+		StreamFlightRecorder< char > stream( "recorder.test" );
+		auto & target = stream.GetOutputTarget();
+		allOK &= &target.GetRecorder() == recorder.get();
+		std::string expected;
+		for ( int i = 0; i < 200; ++i )
+		{
+			stream << "line " << i << endl;
+			if ( i >= 200 - 16 )
+				expected += "line " + std::to_string( i ) + "\n";
+		}
+		std::ostringstream dumped;
+		target.Dump( dumped );
+		allOK &= dumped.str() == expected;
+
+		std::string longLine( 3 * FlightRecorder::kPayloadBytes - 10, 'x' );
+		stream << longLine << endl;
+		target.SetTrigger( kPriorityMax, kFilename );
+		stream << Priority( 0 ) << "fatal" << endl;
+		target.WaitForDumps();
+		std::string contents = readFile( kFilename );
+		allOK &= contents.size() > longLine.size() && contents.substr( contents.size() - longLine.size() - 7 ) == longLine + "\nfatal\n";
+
+		// a channel's line triggers a dump at the channel's priority
+		std::remove( kFilename );
+		OutputChannel< char > channel( 3001, { &stream }, true );
+		channel << "routine" << endl;
+		target.WaitForDumps();
+		allOK &= !std::ifstream( kFilename ).good();
+		channel << Priority( 0 ) << "channel fatal" << endl;
+		target.WaitForDumps();
+		contents = readFile( kFilename );
+		allOK &= contents.size() > 22 && contents.substr( contents.size() - 22 ) == "routine\nchannel fatal\n";
+		allOK &= 0 == target.GetErrorCount();
+	}
+
+	FlightRecorder shared( 1024 * 1024 );
+	std::vector< std::thread > producers;
+	for ( int t = 0; t < 4; ++t )
+		producers.emplace_back( [ &shared, t ]
+		{
+			for ( int i = 0; i < 2000; ++i )
+			{
+				std::string line = std::to_string( t ) + ":" + std::to_string( i ) + "\n";
+				shared.Record( line.data(), line.size() );
+			}
+		} );
+	for ( auto & i : producers )
+		i.join();
+	int next[ 4 ] = {};
+	shared.ForEach( [ & ]( char const * data_, size_t numBytes_ )
+	{
+		std::string line( data_, numBytes_ );
+		int t = line[ 0 ] - '0';
+		allOK &= t >= 0 && t < 4 && line == std::to_string( t ) + ":" + std::to_string( next[ t ] ) + "\n";
+		++next[ t & 3 ];
+	} );
+	for ( auto i : next )
+		allOK &= 2000 == i;
+	std::remove( kFilename );
+	EXPECT_EQ( allOK, true );
+}
+
+#if defined( __linux )
+// Check O_DIRECT output across several blocks arrives in order, and that a flush leaves the file at exactly the bytes written so far
+TEST( GeneralTests, CheckDirectFile )
+{
+	auto constexpr kFilename = "direct.test.txt";
+	auto readFile = [ kFilename ]()
+	{
+		std::ifstream inFile( kFilename, std::ios::binary );
+		return std::string( std::istreambuf_iterator< char >( inFile ), std::istreambuf_iterator< char >() );
+	};
+	std::string expected;
+	bool allOK = true;
+	{
+		StreamDirectFile< char > stream( kFilename );
+		std::string const padding( 200, '.' );
+		for ( int i = 0; i < 20000; ++i )
+		{
+			stream << "direct line " << i << padding << endl;
+			expected += "direct line " + std::to_string( i ) + padding + "\n";
+		}
+		stream.GetOutputTarget().Flush();
+		allOK &= readFile() == expected;
+		stream << "after flush" << endl;
+		expected += "after flush\n";
+		EXPECT_EQ( stream.m_metrics.targetErrors.Get(), 0u );
+	}
+	allOK &= readFile() == expected && expected.size() > 3 * OutputDirectFile_t< char >::kBlockBytes;
+	std::remove( kFilename );
+	EXPECT_EQ( allOK, true );
+}
+
+// Check a descriptor that isn't a terminal is buffered, written by Flush() and by the flush timer
+TEST( GeneralTests, CheckStdFd )
+{
+	auto constexpr kFilename = "stdfd.test.txt";
+	auto readFile = [ kFilename ]()
+	{
+		std::ifstream inFile( kFilename, std::ios::binary );
+		return std::string( std::istreambuf_iterator< char >( inFile ), std::istreambuf_iterator< char >() );
+	};
+	int desc = open( kFilename, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	bool allOK = desc >= 0;
+	{
+		StreamStdFd< char > stream( std::to_string( desc ).c_str() );
+		auto & target = stream.GetOutputTarget();
+		target.SetFlushInterval( std::chrono::milliseconds( 0 ) );
+		allOK &= !target.IsInteractive();
+		stream << "buffered" << endl;
+		allOK &= readFile().empty();
+		target.Flush();
+		allOK &= readFile() == "buffered\n";
+
+		target.SetFlushInterval( std::chrono::milliseconds( 10 ) );
+		stream << "timed" << endl;
+		for ( int i = 0; i < 100 && readFile().size() != 15; ++i )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+		allOK &= readFile() == "buffered\ntimed\n";
+		allOK &= 0 == target.GetErrorCount();
+	}
+	close( desc );
+	std::remove( kFilename );
+	EXPECT_EQ( allOK, true );
+}
+
+// Check a shared flight recorder's records can be read after its process is killed, and that reopening it carries on from them
+TEST( GeneralTests, CheckSharedRecorder )
+{
+	std::string name = "/streamtest.recorder." + std::to_string( getpid() );
+	shm_unlink( name.c_str() );
+	pid_t child = fork();
+	if ( 0 == child )
+	{
+		StreamSharedRecorder< char > stream( name.c_str() );
+		for ( int i = 0; i < 50; ++i )
+			stream << "before crash " << i << endl;
+		kill( getpid(), SIGKILL );
+	}
+	int status = 0;
+	bool allOK = child > 0 && waitpid( child, &status, 0 ) == child && WIFSIGNALED( status );
+
+	auto readRecords = [ &name ]()
+	{
+		std::string records;
+		if ( auto recorder = MapFlightRecorder( name ) )
+			recorder->ForEach( [ &records ]( char const * data_, size_t numBytes_ ) { records.append( data_, numBytes_ ); } );
+		return records;
+	};
+	std::string expected;
+	for ( int i = 0; i < 50; ++i )
+		expected += "before crash " + std::to_string( i ) + "\n";
+	allOK &= readRecords() == expected;
+	{
+		StreamSharedRecorder< char > stream( name.c_str() );
+		stream << "restarted" << endl;
+		allOK &= 0 == stream.GetOutputTarget().GetErrorCount();
+	}
+	allOK &= readRecords() == expected + "restarted\n";
+	shm_unlink( name.c_str() );
+	EXPECT_EQ( allOK, true );
+}
+#endif // #if defined( __linux )
+
 TEST( StreamTests, TestConvertingStreamsAllStrings )
 {
 	bool allOK;
@@ -937,7 +1995,8 @@ TEST( StreamTests, TestConvertingStreamsAllStrings )
 	auto sizeReference = baseRef.GetSize();
 	auto sizeDestination = destRef.GetSize();
 	allOK &= sizeReference == sizeDestination;
-	allOK &= 0 == memcmp( destRef.GetBase(), baseRef.GetBase(), sizeReference );
+	// compare only the bytes written, the remainder of each buffer is uninitialised
+	allOK &= 0 == memcmp( destRef.GetBase(), baseRef.GetBase(), baseRef.GetPtr() - baseRef.GetBase() );
 	EXPECT_EQ( allOK, true );
 }
 
@@ -25,6 +25,7 @@ auto constexpr kUTF8Filename = "outUTF8.test.txt";
 auto constexpr kUTF32Filename = "outUTF32.test.txt";
 auto constexpr kUTF16Filename = "outUTF16.test.txt";
 auto constexpr kUTF16ReferenceFilename = "outUTF16_reference.test.txt";
+auto constexpr kUTF8TranscodedFilename = "outUTF8_transcoded.test.txt";
 
 // forward declare file cleanup
 void CleanupFiles();
@@ -37,6 +38,7 @@ char const * kFilesToClean[] = {
 	,	kUTF32Filename
 	,	kUTF16Filename
 	,	kUTF16ReferenceFilename
+	,	kUTF8TranscodedFilename
 };
 
 class TestUsingFiles : public ::testing::Test
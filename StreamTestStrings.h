@@ -0,0 +1,104 @@
+﻿//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	StreamTestStrings.h
+/// Created:	16/8/2022
+/// Author:		Mike
+/// 
+/// Description: Sample UTF8 text shared by the test framework and the benchmarks
+///
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef StreamTestStrings_DEFINED_16_8_2022
+#define StreamTestStrings_DEFINED_16_8_2022
+
+//////////////////////////////////////////////////////////////////////////
+/// Test Strings in UTF8
+//	From https://www.kermitproject.org/utf8.html
+//////////////////////////////////////////////////////////////////////////
+
+inline const char * utf8StringOne =
+u8R"(From the Anglo-Saxon Rune Poem (Rune version):
+ᚠᛇᚻ᛫ᛒᛦᚦ᛫ᚠᚱᚩᚠᚢᚱ᛫ᚠᛁᚱᚪ᛫ᚷᛖᚻᚹᛦᛚᚳᚢᛗ
+ᛋᚳᛖᚪᛚ᛫ᚦᛖᚪᚻ᛫ᛗᚪᚾᚾᚪ᛫ᚷᛖᚻᚹᛦᛚᚳ᛫ᛗᛁᚳᛚᚢᚾ᛫ᚻᛦᛏ᛫ᛞᚫᛚᚪᚾ
+ᚷᛁᚠ᛫ᚻᛖ᛫ᚹᛁᛚᛖ᛫ᚠᚩᚱ᛫ᛞᚱᛁᚻᛏᚾᛖ᛫ᛞᚩᛗᛖᛋ᛫ᚻᛚᛇᛏᚪᚾ᛬)";
+inline const char * utf8StringTwo =
+u8R"(From Laȝamon's Brut (The Chronicles of England, Middle English, West Midlands, ca.1190):
+An preost wes on leoden, Laȝamon was ihoten
+He wes Leovenaðes sone -- liðe him be Drihten.
+He wonede at Ernleȝe at æðelen are chirechen,
+Uppen Sevarne staþe, sel þar him þuhte,
+Onfest Radestone, þer he bock radde.
+(The third letter in the author's name is Yogh, missing from many fonts; CLICK HERE for another Middle English sample with some explanation of letters and encoding).)";
+inline const char * utf8StringThree =
+u8R"(From the Tagelied of Wolfram von Eschenbach (Middle High German):
+Sîne klâwen durh die wolken sint geslagen,
+er stîget ûf mit grôzer kraft,
+ich sih in grâwen tägelîch als er wil tagen,
+den tac, der im geselleschaft
+erwenden wil, dem werden man,
+den ich mit sorgen în verliez.
+ich bringe in hinnen, ob ich kan.
+sîn vil manegiu tugent michz leisten hiez.)";
+inline const char * utf8StringFour =
+u8R"(Some lines of Odysseus Elytis (Greek):
+Monotonic:
+Τη γλώσσα μου έδωσαν ελληνική
+το σπίτι φτωχικό στις αμμουδιές του Ομήρου.
+Μονάχη έγνοια η γλώσσα μου στις αμμουδιές του Ομήρου.
+από το Άξιον Εστί
+του Οδυσσέα Ελύτη)";
+inline const char * utf8StringFive =
+u8R"(Polytonic:
+Τὴ γλῶσσα μοῦ ἔδωσαν ἑλληνικὴ
+τὸ σπίτι φτωχικὸ στὶς ἀμμουδιὲς τοῦ Ὁμήρου.
+Μονάχη ἔγνοια ἡ γλῶσσα μου στὶς ἀμμουδιὲς τοῦ Ὁμήρου.
+ἀπὸ τὸ Ἄξιον ἐστί
+τοῦ Ὀδυσσέα Ἐλύτη)";
+inline const char * utf8StringSix =
+u8R"(The first stanza of Pushkin's Bronze Horseman (Russian):
+На берегу пустынных волн
+Стоял он, дум великих полн,
+И вдаль глядел. Пред ним широко
+Река неслася; бедный чёлн
+По ней стремился одиноко.
+По мшистым, топким берегам
+Чернели избы здесь и там,
+Приют убогого чухонца;
+И лес, неведомый лучам
+В тумане спрятанного солнца,
+Кругом шумел.)";
+inline const char * utf8StringSeven =
+u8R"(Šota Rustaveli's Veṗxis Ṭq̇aosani, ̣︡Th, The Knight in the Tiger's Skin (Georgian):
+ვეპხის ტყაოსანი შოთა რუსთაველი
+ღმერთსი შემვედრე, ნუთუ კვლა დამხსნას სოფლისა შრომასა, ცეცხლს, წყალსა და მიწასა, ჰაერთა თანა მრომასა; მომცნეს ფრთენი და აღვფრინდე, მივჰხვდე მას ჩემსა ნდომასა, დღისით და ღამით ვჰხედვიდე მზისა ელვათა კრთომაასა.)";
+inline const char * utf8StringEight =
+u8R"(Tamil poetry of Subramaniya Bharathiyar: சுப்ரமணிய பாரதியார் (1882-1921):
+யாமறிந்த மொழிகளிலே தமிழ்மொழி போல் இனிதாவது எங்கும் காணோம்,
+பாமரராய் விலங்குகளாய், உலகனைத்தும் இகழ்ச்சிசொலப் பான்மை கெட்டு,
+நாமமது தமிழரெனக் கொண்டு இங்கு வாழ்ந்திடுதல் நன்றோ? சொல்லீர்!
+தேமதுரத் தமிழோசை உலகமெலாம் பரவும்வகை செய்தல் வேண்டும்.)";
+inline const char * utf8StringNine =
+u8R"(Kannada poetry by Kuvempu — ಬಾ ಇಲ್ಲಿ ಸಂಭವಿಸು
+ಬಾ ಇಲ್ಲಿ ಸಂಭವಿಸು ಇಂದೆನ್ನ ಹೃದಯದಲಿ
+ನಿತ್ಯವೂ ಅವತರಿಪ ಸತ್ಯಾವತಾರ
+ಮಣ್ಣಾಗಿ ಮರವಾಗಿ ಮಿಗವಾಗಿ ಕಗವಾಗೀ...
+ಮಣ್ಣಾಗಿ ಮರವಾಗಿ ಮಿಗವಾಗಿ ಕಗವಾಗಿ
+ಭವ ಭವದಿ ಭತಿಸಿಹೇ ಭವತಿ ದೂರ
+ನಿತ್ಯವೂ ಅವತರಿಪ ಸತ್ಯಾವತಾರ || ಬಾ ಇಲ್ಲಿ ||)";
+
+inline const char * AllUTF8Strings[] =
+{
+		utf8StringOne
+	,	utf8StringTwo
+	,	utf8StringThree
+	,	utf8StringFour
+	,	utf8StringFive
+	,	utf8StringSix
+	,	utf8StringSeven
+	,	utf8StringEight
+	,	utf8StringNine
+};
+
+#endif // #ifndef StreamTestStrings_DEFINED_16_8_2022
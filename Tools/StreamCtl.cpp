@@ -0,0 +1,121 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	StreamCtl.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Reads and changes the settings in another process's shared memory control block, see ControlBlock.h
+///
+///				 Usage: streamctl /name list
+///						streamctl /name channel ID enable|priority|default|filter VALUE
+///						streamctl /name stream NAME enable|priority|default|filter VALUE
+///
+///				 A stream command changes every attached stream with that name. Changes take effect on the next line each writes.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "OutputStreams/ControlBlock.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace mbp::streams;
+
+namespace
+{
+	void PrintSettings( StreamSettings & settings_ )
+	{
+		std::printf( "enable %u priority %u default %u filter %u\n", settings_.GetEnable(), settings_.GetPriority(), settings_.GetDefaultPriority(), settings_.GetFilter() );
+	}
+
+	void List( ControlBlock & block_ )
+	{
+		for ( size_t i = 0; i < block_.numChannels; ++i )
+			if ( block_.channels[ i ].attached.load( std::memory_order_acquire ) )
+			{
+				std::printf( "channel %-6zu ", i );
+				PrintSettings( block_.channels[ i ].settings );
+			}
+		for ( auto & stream : block_.streams )
+			if ( ControlBlock::Stream::kAttached == stream.state.load( std::memory_order_acquire ) )
+			{
+				std::printf( "stream  %-24s ", stream.name );
+				PrintSettings( stream.settings );
+			}
+	}
+
+	bool Apply( StreamSettings & settings_, char const * setting_, SettingsType value_ )
+	{
+		if ( 0 == std::strcmp( setting_, "enable" ) )
+			settings_.Enable( value_ );
+		else if ( 0 == std::strcmp( setting_, "priority" ) )
+			settings_.SetPriority( value_ );
+		else if ( 0 == std::strcmp( setting_, "default" ) )
+			settings_.SetDefaultPriority( value_ );
+		else if ( 0 == std::strcmp( setting_, "filter" ) )
+			settings_.SetFilter( value_ );
+		else
+			return false;
+		return true;
+	}
+
+	int Usage()
+	{
+		std::fprintf( stderr, "usage: streamctl /name list\n"
+			"       streamctl /name channel ID enable|priority|default|filter VALUE\n"
+			"       streamctl /name stream NAME enable|priority|default|filter VALUE\n" );
+		return 2;
+	}
+}
+
+int main( int argc, char ** argv )
+{
+	if ( argc < 3 )
+		return Usage();
+	ControlBlock * block = MapControlBlock( argv[ 1 ] );
+	if ( !block )
+	{
+		std::fprintf( stderr, "streamctl: no control block named %s\n", argv[ 1 ] );
+		return 1;
+	}
+
+	if ( 0 == std::strcmp( argv[ 2 ], "list" ) )
+	{
+		List( *block );
+		return 0;
+	}
+	if ( argc != 6 )
+		return Usage();
+
+	SettingsType value = static_cast< SettingsType >( std::strtoul( argv[ 5 ], nullptr, 0 ) );
+	if ( 0 == std::strcmp( argv[ 2 ], "channel" ) )
+	{
+		size_t channelID = std::strtoul( argv[ 3 ], nullptr, 10 );
+		if ( channelID >= block->numChannels || !block->channels[ channelID ].attached.load( std::memory_order_acquire ) )
+		{
+			std::fprintf( stderr, "streamctl: channel %s is not in use\n", argv[ 3 ] );
+			return 1;
+		}
+		return Apply( block->channels[ channelID ].settings, argv[ 4 ], value ) ? 0 : Usage();
+	}
+	if ( 0 == std::strcmp( argv[ 2 ], "stream" ) )
+	{
+		size_t matched = 0;
+		for ( auto & stream : block->streams )
+			if ( ControlBlock::Stream::kAttached == stream.state.load( std::memory_order_acquire ) && 0 == std::strcmp( stream.name, argv[ 3 ] ) )
+			{
+				if ( !Apply( stream.settings, argv[ 4 ], value ) )
+					return Usage();
+				++matched;
+			}
+		if ( !matched )
+		{
+			std::fprintf( stderr, "streamctl: no stream named %s\n", argv[ 3 ] );
+			return 1;
+		}
+		return 0;
+	}
+	return Usage();
+}
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////
+/// Mike Brown, 2022
+///
+/// Filename:	StreamTail.cpp
+/// Created:	19/10/2026
+/// Author:		Mike
+///
+/// Description: Prints the records in a shared flight recorder ring, see OutputSharedRecorder_t, whether or not its process is still running
+///
+///				 Usage: streamtail NAME [-n RECORDS] [-f]
+///
+///				 NAME is the shared memory object ( "/name" ) or file the ring was opened with. Prints every complete record, oldest first,
+///				 or only the last RECORDS of them, then with -f carries on printing records as they are completed.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "OutputStreams/FlightRecorder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+
+using namespace mbp::streams;
+
+namespace
+{
+	int Usage()
+	{
+		std::fprintf( stderr, "usage: streamtail NAME [-n RECORDS] [-f]\n" );
+		return 2;
+	}
+
+	void Print( char const * data_, size_t numBytes_ )
+	{
+		std::fwrite( data_, 1, numBytes_, stdout );
+	}
+}
+
+int main( int argc, char ** argv )
+{
+	if ( argc < 2 )
+		return Usage();
+	size_t numRecords = 0;
+	bool follow = false;
+	for ( int i = 2; i < argc; ++i )
+	{
+		if ( 0 == std::strcmp( argv[ i ], "-f" ) )
+			follow = true;
+		else if ( 0 == std::strcmp( argv[ i ], "-n" ) && i + 1 < argc )
+			numRecords = std::strtoul( argv[ ++i ], nullptr, 10 );
+		else
+			return Usage();
+	}
+	auto recorder = MapFlightRecorder( argv[ 1 ] );
+	if ( !recorder )
+	{
+		std::fprintf( stderr, "streamtail: no flight recorder named %s\n", argv[ 1 ] );
+		return 1;
+	}
+
+	uint64_t sequence;
+	if ( numRecords )
+	{
+		std::deque< std::string > tail;
+		sequence = recorder->ForEach( [ &tail, numRecords ]( char const * data_, size_t numBytes_ )
+		{
+			tail.emplace_back( data_, numBytes_ );
+			if ( tail.size() > numRecords )
+				tail.pop_front();
+		}, 0, follow );
+		for ( auto & i : tail )
+			Print( i.data(), i.size() );
+	}
+	else
+		sequence = recorder->ForEach( Print, 0, follow );
+	std::fflush( stdout );
+
+	// a record left pending by a process that died part way through it is passed over once newer records arrive and it still hasn't completed
+	auto constexpr kPoll = std::chrono::milliseconds( 100 );
+	auto constexpr kAbandoned = std::chrono::seconds( 1 );
+	auto stalled = std::chrono::steady_clock::duration::zero();
+	while ( follow )
+	{
+		std::this_thread::sleep_for( kPoll );
+		uint64_t next = recorder->ForEach( Print, sequence, true );
+		std::fflush( stdout );
+		if ( next == sequence && next < recorder->GetSequence() )
+		{
+			stalled += kPoll;
+			if ( stalled >= kAbandoned )
+			{
+				++next;
+				stalled = stalled.zero();
+			}
+		}
+		else
+			stalled = stalled.zero();
+		sequence = next;
+	}
+	return 0;
+}
@@ -10,6 +10,8 @@
 ///
 //////////////////////////////////////////////////////////////////////////
 
+#include <cstdint>
+#include <cstring>
 #include "Strings.h"
 
 namespace mbp
@@ -168,6 +170,78 @@ namespace mbp
 			return bytes;
 		}
 
+		size_t GetValidCodepointAndCountFromUTF8( char const * pSource_, char32_t & cpOut_, bool & valid_ )
+		{
+			unsigned char const * ptr = reinterpret_cast< unsigned char const * >( pSource_ );
+			unsigned char lead = *ptr;
+			valid_ = true;
+			if ( lead < 0200 )
+			{
+				cpOut_ = lead;
+				return 1;
+			}
+			// the trailing byte count and the permitted range of the first trailing byte, which excludes overlong forms, surrogates and values beyond 0x10FFFF
+			size_t trailing;
+			unsigned char low = 0x80, high = 0xBF;
+			char32_t code;
+			if ( lead >= 0xC2 && lead <= 0xDF )
+			{
+				trailing = 1;
+				code = lead & 0x1F;
+			}
+			else if ( lead >= 0xE0 && lead <= 0xEF )
+			{
+				trailing = 2;
+				code = lead & 0xF;
+				if ( lead == 0xE0 )
+					low = 0xA0;
+				else if ( lead == 0xED )
+					high = 0x9F;
+			}
+			else if ( lead >= 0xF0 && lead <= 0xF4 )
+			{
+				trailing = 3;
+				code = lead & 0x7;
+				if ( lead == 0xF0 )
+					low = 0x90;
+				else if ( lead == 0xF4 )
+					high = 0x8F;
+			}
+			else
+			{
+				valid_ = false;
+				cpOut_ = kReplacementCharacter;
+				return 1;
+			}
+			size_t count = 1;
+			for ( ; count <= trailing; ++count )
+			{
+				// a terminating zero fails this test so we never read beyond the end of the string
+				unsigned char next = ptr[ count ];
+				if ( next < low || next > high )
+				{
+					valid_ = false;
+					cpOut_ = kReplacementCharacter;
+					return count;
+				}
+				low = 0x80;
+				high = 0xBF;
+				code = ( code << 6 ) | ( next & 0x3F );
+			}
+			cpOut_ = code;
+			return count;
+		}
+
+		size_t GetValidCodepointAndBytesFromUTF16( char16_t const * pSource_, char32_t & cpOut_, bool & valid_ )
+		{
+			size_t bytes = GetCodepointAndBytesFromUTF16( pSource_, cpOut_ );
+			// a surrogate here is one that was not part of a pair
+			valid_ = IsValidCodepoint( cpOut_ );
+			if ( !valid_ )
+				cpOut_ = kReplacementCharacter;
+			return bytes;
+		}
+
 		void GetUTF8FromCodePoint( char32_t const cp_, char * pOut_ )
 		{
 			if ( cp_ >= 0200 )
@@ -351,5 +425,65 @@ namespace mbp
 				pOut_ += count;
 			}
 		}
+
+		// The bulk converters below test several source characters at once for an all-ASCII run (the common case for log output) and narrow them in a single
+		// pass, which the compiler is free to vectorise. Anything else drops through to the per-codepoint encoder.
+
+		size_t UTF32ToUTF8( char32_t const * pSource_, size_t numChars_, char * pOut_ )
+		{
+			char * pStart = pOut_;
+			char32_t const * pEnd = pSource_ + numChars_;
+			while ( pSource_ < pEnd )
+			{
+				if ( pEnd - pSource_ >= 4 && ( ( pSource_[ 0 ] | pSource_[ 1 ] | pSource_[ 2 ] | pSource_[ 3 ] ) < 0200 ) )
+				{
+					pOut_[ 0 ] = static_cast< char >( pSource_[ 0 ] );
+					pOut_[ 1 ] = static_cast< char >( pSource_[ 1 ] );
+					pOut_[ 2 ] = static_cast< char >( pSource_[ 2 ] );
+					pOut_[ 3 ] = static_cast< char >( pSource_[ 3 ] );
+					pOut_ += 4;
+					pSource_ += 4;
+					continue;
+				}
+				char32_t cp = *pSource_++;
+				GetUTF8FromCodePoint( cp, pOut_ );
+				pOut_ += NumUTF8CharsFromCodepoint( cp );
+			}
+			return pOut_ - pStart;
+		}
+
+		size_t UTF16ToUTF8( char16_t const * pSource_, size_t numChars_, char * pOut_ )
+		{
+			uint64_t constexpr kNonASCIIMask = 0xFF80FF80FF80FF80ull;
+			char * pStart = pOut_;
+			char16_t const * pEnd = pSource_ + numChars_;
+			uint64_t quad;
+			while ( pSource_ < pEnd )
+			{
+				if ( pEnd - pSource_ >= 4 )
+				{
+					memcpy( &quad, pSource_, sizeof( quad ) );
+					if ( 0 == ( quad & kNonASCIIMask ) )
+					{
+						pOut_[ 0 ] = static_cast< char >( pSource_[ 0 ] );
+						pOut_[ 1 ] = static_cast< char >( pSource_[ 1 ] );
+						pOut_[ 2 ] = static_cast< char >( pSource_[ 2 ] );
+						pOut_[ 3 ] = static_cast< char >( pSource_[ 3 ] );
+						pOut_ += 4;
+						pSource_ += 4;
+						continue;
+					}
+				}
+				char32_t cp = *pSource_++;
+				// only combine a surrogate pair when both halves lie within the counted range
+				if ( ( cp >= 0xD800 ) && ( cp < 0xDC00 ) && ( pSource_ < pEnd ) && ( *pSource_ >= 0xDC00 ) && ( *pSource_ < 0xE000 ) )
+				{
+					cp = ( ( cp - 0xD800 ) << 10 ) + ( *pSource_++ - 0xDC00 ) + 0x10000;
+				}
+				GetUTF8FromCodePoint( cp, pOut_ );
+				pOut_ += NumUTF8CharsFromCodepoint( cp );
+			}
+			return pOut_ - pStart;
+		}
 	}
-}
\ No newline at end of file
+}
@@ -19,6 +19,15 @@ namespace mbp
 {
 	namespace strings
 	{
+		// worst case UTF8 expansion of a single source character, for sizing the bulk conversion buffers below
+		auto constexpr kMaxUTF8BytesPerUTF32 = 4;
+		auto constexpr kMaxUTF8BytesPerUTF16 = 3;
+		// substituted for malformed sequences when repairing text
+		char32_t constexpr kReplacementCharacter = 0xFFFD;
+		// the UTF8 encoding of the above
+		auto constexpr kReplacementUTF8 = "\xEF\xBF\xBD";
+		auto constexpr kReplacementUTF8Length = 3;
+
 		// string encoding converters
 		size_t GetUTF8StringLengthInBytes( void const * pSource_ );
 		size_t GetUTF16StringLengthInBytes( void const * pSource_ );
@@ -37,6 +46,11 @@ namespace mbp
 		size_t GetCodepointAndCountFromUTF8( char const * pSource_, char32_t & cp_ );
 		// converts a UTF16 character into a UTF32 character (by reference) returning the number of bytes in the UTF8 encoding
 		size_t GetCodepointAndBytesFromUTF16( char16_t const * pSource_, char32_t & cp_ );
+		// validating versions of the above. A malformed sequence sets valid_ to false, yields kReplacementCharacter and consumes its maximal valid subpart (at least one code unit)
+		size_t GetValidCodepointAndCountFromUTF8( char const * pSource_, char32_t & cp_, bool & valid_ );
+		size_t GetValidCodepointAndBytesFromUTF16( char16_t const * pSource_, char32_t & cp_, bool & valid_ );
+		// true if the codepoint is a Unicode scalar value, i.e. within range and not a surrogate
+		inline bool IsValidCodepoint( char32_t const cp_ ) { return cp_ < 0xD800 || ( cp_ > 0xDFFF && cp_ < 0x110000 ); }
 		// coverts a single UTF32 codepoint into a UTF8 sequence
 		void GetUTF8FromCodePoint( char32_t const cp_, char * pOut_ );
 		// coverts a single UTF32 codepoint into a UTF16 sequence
@@ -47,6 +61,10 @@ namespace mbp
 		void UTF32ToUTF8( char32_t const * pSource_, char * pOut_ );
 		// convert a UTF8 sequence to a UTF16 sequence
 		void UTF8ToUTF16( char const * pSource_, char16_t * pOut_ );
+		// bulk convert a counted UTF32 sequence to UTF8, returning the number of bytes written. pOut_ must hold kMaxUTF8BytesPerUTF32 bytes per source character
+		size_t UTF32ToUTF8( char32_t const * pSource_, size_t numChars_, char * pOut_ );
+		// bulk convert a counted UTF16 sequence to UTF8, returning the number of bytes written. pOut_ must hold kMaxUTF8BytesPerUTF16 bytes per source character
+		size_t UTF16ToUTF8( char16_t const * pSource_, size_t numChars_, char * pOut_ );
 	}
 }
 